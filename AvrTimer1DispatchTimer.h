@@ -0,0 +1,79 @@
+/**
+ * Code written by Mark Womack
+ * Distributed under the Apache License 2.0, a copy of which should accompany
+ * this file.
+ *
+ * A DispatchTimer that uses the compare match interrupt of the 16 bit Timer1
+ * of AVR microcontrollers, such as the ATmega328P of the Arduino Uno. The
+ * timer runs in CTC mode with the smallest prescaler that fits the period, so
+ * the callback is called with the jitter of the interrupt entry only, no
+ * matter what the loop method is doing. That is a few microseconds at most
+ * while other interrupt handlers, such as the one of millis, are short.
+ *
+ * This header defines the interrupt handler, so it must be included in only
+ * one file of the sketch. Timer1 is also used by other libraries, such as
+ * Servo, which can not be used at the same time.
+ */
+
+#ifndef AVR_TIMER1_DISPATCH_TIMER_H
+#define AVR_TIMER1_DISPATCH_TIMER_H
+
+#include <Arduino.h>
+#include <inttypes.h>
+#include "DispatchTimer.h"
+
+#if !defined(__AVR__) || !defined(TIMSK1)
+#error "AvrTimer1DispatchTimer requires an AVR microcontroller with Timer1"
+#endif
+
+class AvrTimer1DispatchTimer : public DispatchTimer {
+
+public:
+  boolean start(unsigned long periodInMicros, void (*callback)(void)) {
+    if (periodInMicros > 0xFFFFFFFFUL / (F_CPU / 1000000UL)) {
+      return false;
+    }
+
+    // Clock select 1 to 5 divide the clock by 1, 8, 64, 256 and 1024
+    static const uint8_t PRESCALER_SHIFTS[] = { 0, 3, 6, 8, 10 };
+    unsigned long cycles = periodInMicros * (F_CPU / 1000000UL);
+    for(uint8_t prescaler = 0; prescaler < 5; prescaler++) {
+      unsigned long ticks = cycles >> PRESCALER_SHIFTS[prescaler];
+      if (ticks > 0x10000UL) {
+        continue;
+      }
+      if (ticks == 0) {
+        return false;
+      }
+
+      uint8_t oldSREG = SREG;
+      cli();
+      _callback = callback;
+      TCCR1A = 0;
+      TCCR1B = _BV(WGM12) | (prescaler + 1);
+      TCNT1 = 0;
+      OCR1A = ticks - 1;
+      TIFR1 = _BV(OCF1A);
+      TIMSK1 |= _BV(OCIE1A);
+      SREG = oldSREG;
+      return true;
+    }
+    return false;
+  }
+
+  void stop() {
+    TIMSK1 &= ~_BV(OCIE1A);
+    TCCR1B = 0;
+  }
+
+  // Called by the interrupt handler
+  static void (* volatile _callback)(void);
+};
+
+void (* volatile AvrTimer1DispatchTimer::_callback)(void) = NULL;
+
+ISR(TIMER1_COMPA_vect) {
+  (*(AvrTimer1DispatchTimer::_callback))();
+}
+
+#endif
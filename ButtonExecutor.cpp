@@ -6,23 +6,518 @@
 
 #include "ButtonExecutor.h"
 
-static int MAX_NUMBER_OF_CALLBACKS(MAX_NUMBER_OF_EVENTS - 1);
+int readButtonPin(uint8_t pin);
+
+// Callback ids and scheduler references are stored as int8_t, the ids of
+// the dispatch timers, core callbacks, pin callbacks and condition callbacks
+// follow the ids of the scheduled callbacks
+static_assert(SCHEDULER_MAX_EVENTS <= 128,
+  "ButtonExecutor supports at most 127 callbacks");
+static_assert(SCHEDULER_MAX_EVENTS - 1 + BUTTON_EXECUTOR_DISPATCH_TIMERS
+  + BUTTON_EXECUTOR_CORE_CALLBACKS + BUTTON_EXECUTOR_WATCHES
+  + BUTTON_EXECUTOR_CONDITIONS <= 127,
+  "ButtonExecutor supports at most 127 callbacks, timers, core, pin and "
+  "condition callbacks");
+
+// Rows of the profile are kept in a uint8_t, NO_PROFILE excluded
+static_assert(BUTTON_EXECUTOR_PROFILE_SIZE < 255,
+  "BUTTON_EXECUTOR_PROFILE_SIZE is larger than 254");
+
+// The scheduler of the second core must fit all of its callbacks
+static_assert(BUTTON_EXECUTOR_CORE_CALLBACKS <= SCHEDULER_MAX_EVENTS,
+  "BUTTON_EXECUTOR_CORE_CALLBACKS is larger than the scheduler");
+
+// One event of the scheduler checks the button, the rest are for callbacks
+#define MAX_NUMBER_OF_CALLBACKS (SCHEDULER_MAX_EVENTS - 1)
+#define FIRST_CORE_CALLBACK_ID \
+  (MAX_NUMBER_OF_CALLBACKS + BUTTON_EXECUTOR_DISPATCH_TIMERS)
+#define FIRST_WATCH_ID \
+  (FIRST_CORE_CALLBACK_ID + BUTTON_EXECUTOR_CORE_CALLBACKS)
+#define FIRST_CONDITION_ID (FIRST_WATCH_ID + BUTTON_EXECUTOR_WATCHES)
 static long BUTTON_INTERVAL_MS(10);
+static uint16_t RESET_RECORD_MAGIC(0xBE5C);
+
+// Periods are kept in 16 bits when BUTTON_EXECUTOR_SHORT_PERIODS is defined
+#ifdef BUTTON_EXECUTOR_SHORT_PERIODS
+typedef uint16_t Period;
+static unsigned long MAX_PERIOD_MS(0xFFFFUL);
+#else
+typedef unsigned long Period;
+static unsigned long MAX_PERIOD_MS(0xFFFFFFFFUL);
+#endif
+
+// Reference of a callback registered during dispatch, not yet scheduled
+#define PENDING_REFERENCE (-4)
+// Reference of a callback called by the frame table of the cyclic executive
+#define CYCLIC_REFERENCE (-5)
+#define NO_PROFILE (0xFF)
+// Time to wait for the second core when no graceful stop timeout is set
+#define CORE_STOP_TIMEOUT_MS (1000)
+
+// Slots are tracked in bitmaps of unsigned long words, one bit per slot
+#define SLOT_WORD_BITS (8 * sizeof(unsigned long))
+#define SLOT_WORDS \
+  ((MAX_NUMBER_OF_CALLBACKS + SLOT_WORD_BITS - 1) / SLOT_WORD_BITS)
+
+/**
+ * The debug messages are kept in flash and referred to by their id. The ids
+ * are printed instead of the text when message ids are enabled, the README
+ * has the table to decode them. New messages must be added at the end.
+ */
+enum {
+  MSG_SETTING_UP,
+  MSG_READY,
+  MSG_RESET_IN_CALLBACK,
+  MSG_DURATION_LIMIT,
+  MSG_ABORTING,
+  MSG_STARTING,
+  MSG_STOPPING,
+  MSG_DRAINING,
+  MSG_DRAINING_TIMED_OUT,
+  MSG_INVOCATION_LIMIT,
+  MSG_LOAD_PERCENT,
+  MSG_LOOP_FREQUENCY,
+  MSG_NOT_SCHEDULABLE,
+  MSG_FRAME_TABLE_TOO_LARGE,
+  MSG_NOT_SCHEDULED,
+  MSG_STATIC_TASK_DROPPED,
+  MSG_NOT_STOPPED
+};
+
+static const char MSG_SETTING_UP_TEXT[] PROGMEM = "*** Setting up";
+static const char MSG_READY_TEXT[] PROGMEM = "*** Ready to start execution";
+static const char MSG_RESET_IN_CALLBACK_TEXT[] PROGMEM =
+  "*** Reset while running callback ";
+static const char MSG_DURATION_LIMIT_TEXT[] PROGMEM =
+  "*** Run duration limit reached";
+static const char MSG_ABORTING_TEXT[] PROGMEM =
+  "*** Aborting execution by request!";
+static const char MSG_STARTING_TEXT[] PROGMEM = "*** Starting execution";
+static const char MSG_STOPPING_TEXT[] PROGMEM = "*** Stopping execution";
+static const char MSG_DRAINING_TEXT[] PROGMEM = "*** Draining execution";
+static const char MSG_DRAINING_TIMED_OUT_TEXT[] PROGMEM =
+  "*** Draining timed out";
+static const char MSG_INVOCATION_LIMIT_TEXT[] PROGMEM =
+  "*** Run invocation limit reached";
+static const char MSG_LOAD_PERCENT_TEXT[] PROGMEM = "*** Load % ";
+static const char MSG_LOOP_FREQUENCY_TEXT[] PROGMEM = "*** Loop Hz ";
+static const char MSG_NOT_SCHEDULABLE_TEXT[] PROGMEM =
+  "*** Above rate-monotonic bound, utilization % ";
+static const char MSG_FRAME_TABLE_TOO_LARGE_TEXT[] PROGMEM =
+  "*** Frame table too large, scheduling as usual";
+static const char MSG_NOT_SCHEDULED_TEXT[] PROGMEM =
+  "*** Not scheduled, dropped callback ";
+static const char MSG_STATIC_TASK_DROPPED_TEXT[] PROGMEM =
+  "*** No free slot, dropped static task ";
+static const char MSG_NOT_STOPPED_TEXT[] PROGMEM =
+  "*** Second core did not stop callback ";
+static const char* const MESSAGES[] PROGMEM = {
+  MSG_SETTING_UP_TEXT,
+  MSG_READY_TEXT,
+  MSG_RESET_IN_CALLBACK_TEXT,
+  MSG_DURATION_LIMIT_TEXT,
+  MSG_ABORTING_TEXT,
+  MSG_STARTING_TEXT,
+  MSG_STOPPING_TEXT,
+  MSG_DRAINING_TEXT,
+  MSG_DRAINING_TIMED_OUT_TEXT,
+  MSG_INVOCATION_LIMIT_TEXT,
+  MSG_LOAD_PERCENT_TEXT,
+  MSG_LOOP_FREQUENCY_TEXT,
+  MSG_NOT_SCHEDULABLE_TEXT,
+  MSG_FRAME_TABLE_TOO_LARGE_TEXT,
+  MSG_NOT_SCHEDULED_TEXT,
+  MSG_STATIC_TASK_DROPPED_TEXT,
+  MSG_NOT_STOPPED_TEXT
+};
 
 static Print* _printer;
-static Timer _timer;
+static unsigned long (*_clockMillis)(void) = millis;
+static unsigned long (*_clockMicros)(void) = micros;
+static int (*_readPin)(uint8_t pin) = readButtonPin;
+static boolean _isLoggingIds;
+static ButtonExecutorScheduler _timer;
 static int8_t _buttonPin;
 static int8_t _expectedButtonPressState;
 static int _oldButtonState;
 static boolean _isExecuting;
+static boolean _isDraining;
+static unsigned long _gracefulStopTimeoutMs;
+static unsigned long _drainStartTime;
+static unsigned long _executionStartTime;
+static unsigned long _maxDurationMs;
+static void (*_countedCallback)(void);
+static unsigned long _maxInvocations;
+static unsigned long _invocations;
 static void (*_sketchStartCallback)(void);
 static void (*_sketchStopCallback)(void);
-static int8_t _callbackReferences[MAX_NUMBER_OF_EVENTS];
+#if BUTTON_EXECUTOR_SCHEDULABILITY_CHECK
+static uint8_t _schedulabilityCheck;
+#endif
+
+#if BUTTON_EXECUTOR_PROFILE_SIZE > 0
+// Maximum execution time of every callback seen while profiling, the
+// callback slots refer to their row so rows outlive stopped callbacks
+struct CallbackProfile {
+  void (*callback)(void);
+  Period periodInMs;
+  unsigned long maxMicros;
+  int8_t callbackId;
+};
+static boolean _isProfiling;
+static CallbackProfile _profiles[BUTTON_EXECUTOR_PROFILE_SIZE];
+static uint8_t _numberOfProfiles;
+#endif
+
+// Everything kept about a callback slot, packed together so a dispatch reads
+// a single entry. The scheduler only holds the dispatcher of the slot, so the
+// callback is kept here, and the period to arm the slot again at the end of
+// a pass or on the next start. The fields of optional features are only
+// there when the feature is built in, the wider ones first to keep the entry
+// small.
+struct Slot {
+  void (*callback)(void);
+#if BUTTON_EXECUTOR_DRAIN_CALLBACKS
+  boolean (*drainCallback)(void);
+#endif
+#if BUTTON_EXECUTOR_SCHEDULABILITY_CHECK
+  unsigned long wcetInMicros;
+#endif
+  Period period;
+#if BUTTON_EXECUTOR_PHASES
+  Period phase;
+#endif
+  int8_t reference;
+#if BUTTON_EXECUTOR_PROFILE_SIZE > 0
+  uint8_t profile;
+#endif
+};
+static Slot _slots[MAX_NUMBER_OF_CALLBACKS];
+static unsigned long _occupiedSlots[SLOT_WORDS];
+static unsigned long _stopPendingSlots[SLOT_WORDS];
+#if BUTTON_EXECUTOR_PHASES
+// Slots armed with a phase, rearmed with their period after the first call
+static unsigned long _phaseSlots[SLOT_WORDS];
+#endif
+static boolean _isDispatching;
+static boolean _isStopPending;
+static boolean _hasPendingChanges;
+// Slots reserved by persistent callbacks, which keep their callback and
+// period between runs and are never given to other callbacks
+static unsigned long _persistentSlots[SLOT_WORDS];
+static const StaticTask* _staticTasks;
+static uint8_t _numberOfStaticTasks;
+
+// Cyclic executive, every minor frame calls the slots set in its bitmap
+static boolean _isCyclicExecutive;
+static boolean _isCyclic;
+static boolean _isFrameTablePending;
+static unsigned long _minorFrameMs;
+static unsigned long _majorFrameMs;
+static unsigned long _frameOverruns;
+#if BUTTON_EXECUTOR_CYCLIC_FRAMES > 0
+static unsigned long _frameStartTime;
+static unsigned long _frames[BUTTON_EXECUTOR_CYCLIC_FRAMES][SLOT_WORDS];
+static uint16_t _numberOfFrames;
+static uint16_t _frame;
+#if BUTTON_EXECUTOR_PHASES
+// Slots with a phase of 0 that were not called yet, the scheduler would call
+// them right away so they are called once before the first frame
+static unsigned long _initialSlots[SLOT_WORDS];
+#endif
+#endif
+#if BUTTON_EXECUTOR_DISPATCH_TIMERS > 0
+static DispatchTimer* _dispatchTimers[BUTTON_EXECUTOR_DISPATCH_TIMERS];
+#endif
+#if BUTTON_EXECUTOR_SAMPLE_BUFFERS > 0
+static SampleBufferBase* _sampleBuffers[BUTTON_EXECUTOR_SAMPLE_BUFFERS];
+static void (*_sampleConsumers[BUTTON_EXECUTOR_SAMPLE_BUFFERS])(void);
+static uint8_t _numberOfSampleBuffers;
+#endif
+
+// Pins watched for edges while executing. Where the board supports it, all
+// of the ports of the pins are read at once, directly from the input
+// registers.
+#if BUTTON_EXECUTOR_WATCHES > 0
+#if defined(__AVR__)
+#define WATCH_PORTS
+typedef volatile uint8_t* WatchPort;
+typedef uint8_t WatchMask;
+#elif defined(portInputRegister) && defined(digitalPinToPort) \
+  && defined(digitalPinToBitMask)
+#define WATCH_PORTS
+typedef volatile uint32_t* WatchPort;
+typedef uint32_t WatchMask;
+#endif
+#define NO_WATCH_PORT (0xFF)
+struct Watch {
+  void (*callback)(void);
+  uint8_t pin;
+  uint8_t edge;
+  uint8_t level;
+  boolean isInterrupt;
+#ifdef WATCH_PORTS
+  uint8_t portIndex;
+  WatchMask mask;
+#endif
+};
+static Watch _watches[BUTTON_EXECUTOR_WATCHES];
+static uint8_t _numberOfWatches;
+static boolean _areWatchesArmed;
+static boolean _isUsingPinInterrupts;
+static volatile boolean _isWatchEdgePending[BUTTON_EXECUTOR_WATCHES];
+#ifdef WATCH_PORTS
+static WatchPort _watchPorts[BUTTON_EXECUTOR_WATCHES];
+static uint8_t _numberOfWatchPorts;
+#endif
+#endif
+
+// Conditions evaluated while executing, to call back when they become true
+#if BUTTON_EXECUTOR_CONDITIONS > 0
+struct Condition {
+  void (*callback)(void);
+  boolean (*predicate)(void);
+  unsigned long periodInMs;
+  unsigned long lastCheckTime;
+  boolean isTrue;
+  boolean isOneShot;
+  boolean isSpent;
+};
+static Condition _conditions[BUTTON_EXECUTOR_CONDITIONS];
+static uint8_t _numberOfConditions;
+static boolean _areConditionsArmed;
+#endif
+#if BUTTON_EXECUTOR_CORE_CALLBACKS > 0
+// Every request and stop of a core callback increments its request count,
+// so it is odd while requested. Written by the main core only.
+static volatile uint8_t _coreRequests[BUTTON_EXECUTOR_CORE_CALLBACKS];
+static void (*_coreCallbacks[BUTTON_EXECUTOR_CORE_CALLBACKS])(void);
+static Period _corePeriods[BUTTON_EXECUTOR_CORE_CALLBACKS];
+// Request count last applied by the second core, written by it only
+static volatile uint8_t _coreApplied[BUTTON_EXECUTOR_CORE_CALLBACKS];
+// Only used by the second core
+static ButtonExecutorScheduler _coreTimer;
+static int8_t _coreReferences[BUTTON_EXECUTOR_CORE_CALLBACKS];
+#endif
+static void (*_feedWatchdog)(void);
+static unsigned long _maxPassMicros;
+static int8_t _resetCallbackId;
+// Scheduler event that checks the button, set once setup has been called,
+// kept apart from the slots of the callbacks
+static int8_t _buttonCheckReference = SCHEDULER_NOT_AN_EVENT;
+
+// Survives a reset so the callback running at the time can be reported
+static struct {
+  uint16_t magic;
+  int8_t runningCallbackId;
+} _resetRecord BUTTON_EXECUTOR_NOINIT;
+
+// Latency from the button edge to the sketchStartCallback/sketchStopCallback
+static boolean _isUsingButtonInterrupt;
+static volatile boolean _isButtonEdgePending;
+static volatile unsigned long _buttonEdgeMicros;
+#if BUTTON_EXECUTOR_LATENCY_BUCKETS > 0
+static boolean _hasLatencyEdge;
+static unsigned long _latencyEdgeMicros;
+static uint16_t _latencyHistogram[2][BUTTON_EXECUTOR_LATENCY_BUCKETS];
+#endif
+
+#if BUTTON_EXECUTOR_LOAD_SUBWINDOWS > 0
+// The load is measured over a window made of BUTTON_EXECUTOR_LOAD_SUBWINDOWS
+// parts, the oldest part is dropped every time the current part is complete
+static unsigned long _loadWindowMs;
+static unsigned long _loadReportIntervalMs;
+static unsigned long _lastLoadReportTime;
+static uint8_t _loadSubwindow;
+static unsigned long _loadSubwindowStartTime;
+static unsigned long _loadBusyMicros[BUTTON_EXECUTOR_LOAD_SUBWINDOWS];
+static unsigned long _loadElapsedMicros[BUTTON_EXECUTOR_LOAD_SUBWINDOWS];
+static unsigned long _loadLoops[BUTTON_EXECUTOR_LOAD_SUBWINDOWS];
+static float _loadPercent;
+static unsigned long _loopFrequency;
+#endif
+
+#if BUTTON_EXECUTOR_LOG_BUFFER_SIZE > 0
+static int LOG_BYTES_PER_LOOP(16);
+
+/**
+ * Ring buffer that the debug messages are printed to when logging is
+ * asynchronous. A message that does not fit completely is dropped, so the
+ * output never contains partial messages.
+ */
+class LogBuffer : public Print {
+public:
+  size_t write(uint8_t value) {
+    if (_isDropping) {
+      _isDropping = (value != '\n');
+      return 1;
+    }
+
+    uint16_t next = (_head + 1) % BUTTON_EXECUTOR_LOG_BUFFER_SIZE;
+    if (next == _tail) {
+      // Full, drop what was written of this message and the rest of it
+      _head = _messageStart;
+      _isDropping = (value != '\n');
+      _droppedMessages++;
+      return 1;
+    }
+
+    _buffer[_head] = value;
+    _head = next;
+    if (value == '\n') {
+      _messageStart = _head;
+    }
+    return 1;
+  }
+
+  // Writes up to maxBytes of complete messages to the output
+  void drainTo(Print* output, int maxBytes) {
+    while (maxBytes-- > 0 && _tail != _messageStart) {
+      output->write(_buffer[_tail]);
+      _tail = (_tail + 1) % BUTTON_EXECUTOR_LOG_BUFFER_SIZE;
+    }
+  }
+
+  unsigned long getDroppedMessages() {
+    return _droppedMessages;
+  }
+
+private:
+  uint8_t _buffer[BUTTON_EXECUTOR_LOG_BUFFER_SIZE];
+  uint16_t _head;
+  uint16_t _tail;
+  uint16_t _messageStart;
+  boolean _isDropping;
+  unsigned long _droppedMessages;
+};
+
+static LogBuffer _logBuffer;
+static boolean _isAsyncLogging;
+#endif
+
+#if BUTTON_EXECUTOR_TRACE_SIZE > 0
+static TraceEvent _trace[BUTTON_EXECUTOR_TRACE_SIZE];
+static uint16_t _traceHead;
+static uint16_t _traceCount;
+static const char TRACE_DISPATCH_NAME[] PROGMEM = "dispatch";
+static const char TRACE_START_NAME[] PROGMEM = "start";
+static const char TRACE_STOP_NAME[] PROGMEM = "stop";
+static const char TRACE_BUTTON_PRESS_NAME[] PROGMEM = "press";
+static const char TRACE_BUTTON_RELEASE_NAME[] PROGMEM = "release";
+static const char* const TRACE_TYPE_NAMES[] PROGMEM = {
+  TRACE_DISPATCH_NAME,
+  TRACE_START_NAME,
+  TRACE_STOP_NAME,
+  TRACE_BUTTON_PRESS_NAME,
+  TRACE_BUTTON_RELEASE_NAME
+};
+#endif
 
 void checkButton(void);
 void startExecution(void);
 void stopExecution(void);
-void printMsg(const char msg[]);
+void resetExecution(void);
+void stopDispatchTimers(void);
+void stopCoreCallbacks(void);
+boolean isCoreStopped(void);
+#if BUTTON_EXECUTOR_CORE_CALLBACKS > 0
+void dispatchCoreCallback(int entry);
+#endif
+void drainExecution(void);
+void drainSampleBuffers(void);
+void finishExecution(void);
+unsigned long nowMillis(void);
+unsigned long nowMicros(void);
+Print* logOutput(void);
+void drainLog(void);
+void printMsg(uint8_t messageId);
+void printMsg(uint8_t messageId, long value);
+void printMsgText(Print* output, uint8_t messageId);
+void dispatchCallback(int index);
+unsigned long callCallback(int8_t callbackId, void (*callback)(void));
+boolean isSlotSet(const unsigned long* slots, int index);
+void setSlot(unsigned long* slots, int index);
+void clearSlot(unsigned long* slots, int index);
+int findFreeSlot(void);
+boolean scheduleCallback(int index, unsigned long periodInMs,
+  unsigned long phaseInMs, void (*callback)(void));
+boolean armSlot(int index, unsigned long inMs);
+void freeSlot(int index);
+unsigned long getSlotPhase(int index);
+void applyPendingChanges(void);
+void buildFrameTable(void);
+void dispatchFrames(void);
+#if BUTTON_EXECUTOR_SCHEDULABILITY_CHECK
+boolean isSchedulable(unsigned long periodInMs, unsigned long wcetInMicros);
+#endif
+#if BUTTON_EXECUTOR_PROFILE_SIZE > 0
+void clearProfile(void);
+uint8_t findProfile(int index);
+void printProfileTable(void);
+#endif
+void traceEvent(uint8_t type, int8_t callbackId, unsigned long startTime);
+void updateLoadMonitor(void);
+void recordBusyTime(unsigned long duration);
+void buttonEdgeInterrupt(void);
+boolean isEdgeOf(uint8_t edge, int oldLevel, int level);
+void armWatches(void);
+void disarmWatches(void);
+#if BUTTON_EXECUTOR_WATCHES > 0
+void checkWatches(void);
+void watchEdgeInterrupt(int watch);
+#endif
+#if BUTTON_EXECUTOR_CONDITIONS > 0
+void checkConditions(void);
+int8_t declareCondition(boolean (*predicate)(void), unsigned long periodInMs,
+  void (*callback)(void), boolean isOneShot);
+#endif
+void recordLatency(uint8_t latencyType, unsigned long startTime);
+
+/**
+ * The Timer library calls callbacks without any arguments, so every callback
+ * slot gets its own small dispatcher method that knows the index of its slot.
+ * The table of dispatchers is generated at compile time for all of the slots,
+ * for both the main and the second core. It is kept in flash, so its
+ * entries are read with pgm_read_ptr.
+ */
+template<void (*DISPATCH)(int), int INDEX> void dispatchSlot(void) {
+  (*DISPATCH)(INDEX);
+}
+
+template<int... INDEXES> struct SlotIndexes {};
+
+template<int COUNT, int... INDEXES> struct MakeSlotIndexes
+  : MakeSlotIndexes<COUNT - 1, COUNT - 1, INDEXES...> {};
+
+template<int... INDEXES> struct MakeSlotIndexes<0, INDEXES...> {
+  typedef SlotIndexes<INDEXES...> Indexes;
+};
+
+// A plain object rather than a static member of a template, which would
+// not be placed in flash
+template<int COUNT> struct SlotDispatchers {
+  void (*table[COUNT])(void);
+};
+
+template<void (*DISPATCH)(int), int... INDEXES>
+constexpr SlotDispatchers<sizeof...(INDEXES)> makeSlotDispatchers(
+    SlotIndexes<INDEXES...>) {
+  return { { &dispatchSlot<DISPATCH, INDEXES>... } };
+}
+
+static constexpr SlotDispatchers<MAX_NUMBER_OF_CALLBACKS> SLOT_DISPATCHERS
+  PROGMEM = makeSlotDispatchers<dispatchCallback>(
+    MakeSlotIndexes<MAX_NUMBER_OF_CALLBACKS>::Indexes());
+#if BUTTON_EXECUTOR_WATCHES > 0
+static constexpr SlotDispatchers<BUTTON_EXECUTOR_WATCHES> WATCH_INTERRUPTS
+  PROGMEM = makeSlotDispatchers<watchEdgeInterrupt>(
+    MakeSlotIndexes<BUTTON_EXECUTOR_WATCHES>::Indexes());
+#endif
+#if BUTTON_EXECUTOR_CORE_CALLBACKS > 0
+static constexpr SlotDispatchers<BUTTON_EXECUTOR_CORE_CALLBACKS>
+  CORE_SLOT_DISPATCHERS PROGMEM = makeSlotDispatchers<dispatchCoreCallback>(
+    MakeSlotIndexes<BUTTON_EXECUTOR_CORE_CALLBACKS>::Indexes());
+#endif
 
 ButtonExecutor::ButtonExecutor() {
   _printer = NULL;
@@ -37,78 +532,767 @@ void ButtonExecutor::setup(int8_t buttonPin, int8_t expectedButtonPressState,
     void (*sketchStartCallback)(void),
     void (*sketchStopCallback)(void)) {
 
-  printMsg("*** Setting up");
+  printMsg(MSG_SETTING_UP);
+
+  // Called again, start over as after a reset of the microcontroller
+  if (_buttonCheckReference != SCHEDULER_NOT_AN_EVENT) {
+    resetExecution();
+  }
+
+  // Report the callback that was running if a reset interrupted it
+  _resetCallbackId = SCHEDULER_NOT_AN_EVENT;
+  if (_resetRecord.magic == RESET_RECORD_MAGIC
+      && _resetRecord.runningCallbackId != SCHEDULER_NOT_AN_EVENT) {
+    _resetCallbackId = _resetRecord.runningCallbackId;
+    printMsg(MSG_RESET_IN_CALLBACK, _resetCallbackId);
+  }
+  _resetRecord.magic = RESET_RECORD_MAGIC;
+  _resetRecord.runningCallbackId = SCHEDULER_NOT_AN_EVENT;
 			
   _buttonPin = buttonPin;
   _expectedButtonPressState = expectedButtonPressState;
   _oldButtonState = !expectedButtonPressState;
   _isExecuting = false;
+  _isDraining = false;
   _sketchStartCallback = sketchStartCallback;
   _sketchStopCallback = sketchStopCallback;
   for(int index = 0; index < MAX_NUMBER_OF_CALLBACKS; index++) {
-    _callbackReferences[index] = TIMER_NOT_AN_EVENT;
+    _slots[index].reference = SCHEDULER_NOT_AN_EVENT;
+#if BUTTON_EXECUTOR_DRAIN_CALLBACKS
+    _slots[index].drainCallback = NULL;
+#endif
   }
+  memset(_occupiedSlots, 0, sizeof(_occupiedSlots));
+  memset(_stopPendingSlots, 0, sizeof(_stopPendingSlots));
+#if BUTTON_EXECUTOR_PHASES
+  memset(_phaseSlots, 0, sizeof(_phaseSlots));
+#endif
+  memset(_persistentSlots, 0, sizeof(_persistentSlots));
+#if BUTTON_EXECUTOR_SAMPLE_BUFFERS > 0
+  _numberOfSampleBuffers = 0;
+#endif
+#if BUTTON_EXECUTOR_WATCHES > 0
+  _numberOfWatches = 0;
+  _areWatchesArmed = false;
+#endif
+#if BUTTON_EXECUTOR_CONDITIONS > 0
+  _numberOfConditions = 0;
+  _areConditionsArmed = false;
+#endif
 
   // Call the sketchSetupCallback just once
   (*(sketchSetupCallback))();
 
   // Register internal callback for tracking button pushes
   pinMode(_buttonPin, INPUT);
-  _timer.every(BUTTON_INTERVAL_MS, checkButton);
+#ifdef NOT_AN_INTERRUPT
+  if (_isUsingButtonInterrupt
+      && digitalPinToInterrupt(_buttonPin) != NOT_AN_INTERRUPT) {
+    attachInterrupt(digitalPinToInterrupt(_buttonPin), buttonEdgeInterrupt,
+      CHANGE);
+  }
+#endif
+  _buttonCheckReference = _timer.every(BUTTON_INTERVAL_MS, checkButton);
   
-  printMsg("*** Ready to start execution");
+  printMsg(MSG_READY);
 }
 
 void ButtonExecutor::loop() {
+  unsigned long passStartTime = nowMicros();
+
+  // Enforce the run duration before any callbacks are called
+  if (_isExecuting && !_isDraining && _maxDurationMs > 0
+      && nowMillis() - _executionStartTime >= _maxDurationMs) {
+    printMsg(MSG_DURATION_LIMIT);
+    stopExecution();
+  }
+
+  // Changes made while dispatching are applied after the pass
+  _isDispatching = true;
   _timer.update();
+  if (_isCyclic) {
+    dispatchFrames();
+  }
+#if BUTTON_EXECUTOR_WATCHES > 0
+  if (_areWatchesArmed) {
+    checkWatches();
+  }
+#endif
+#if BUTTON_EXECUTOR_CONDITIONS > 0
+  if (_areConditionsArmed) {
+    checkConditions();
+  }
+#endif
+  _isDispatching = false;
+  applyPendingChanges();
+
+  // Keep stepping the drain callbacks until execution can be finished
+  if (_isDraining) {
+    drainExecution();
+  }
+
+#if BUTTON_EXECUTOR_LOAD_SUBWINDOWS > 0
+  if (_loadWindowMs > 0) {
+    updateLoadMonitor();
+  }
+#endif
+
+  drainLog();
+
+  // Only feed the watchdog when the pass completed in time
+  if (_feedWatchdog && nowMicros() - passStartTime <= _maxPassMicros) {
+    (*(_feedWatchdog))();
+  }
+}
+
+void ButtonExecutor::loop1() {
+#if BUTTON_EXECUTOR_CORE_CALLBACKS > 0
+  // Arm and stop callbacks as requested by the main core
+  for(int entry = 0; entry < BUTTON_EXECUTOR_CORE_CALLBACKS; entry++) {
+    uint8_t requests = _coreRequests[entry];
+    if (requests == _coreApplied[entry]) {
+      continue;
+    }
+
+    // Stop the callback if it was armed, then arm it if still requested
+    if (_coreApplied[entry] & 1) {
+      _coreTimer.stop(_coreReferences[entry]);
+    }
+    if (requests & 1) {
+      // The callback was written before the request count
+      __sync_synchronize();
+      _coreReferences[entry] = _coreTimer.every(_corePeriods[entry],
+        (void (*)(void))pgm_read_ptr(&CORE_SLOT_DISPATCHERS.table[entry]));
+    }
+    _coreApplied[entry] = requests;
+  }
+
+  _coreTimer.update();
+#endif
 }
 
 int8_t ButtonExecutor::callbackEveryByMillis(unsigned long periodInMs,
     void (*callback)(void)) {
+  return this->callbackEveryByMillis(periodInMs, callback, 0);
+}
+
+int8_t ButtonExecutor::callbackEveryByMillis(unsigned long periodInMs,
+    void (*callback)(void), unsigned long wcetInMicros) {
 
   // Find the next open callback reference index
-  for(int index = 0; index < MAX_NUMBER_OF_CALLBACKS; index++) {
-    if (_callbackReferences[index] != TIMER_NOT_AN_EVENT) {
-      continue;
-    }
+  int index = findFreeSlot();
+  if (index < 0 || periodInMs > MAX_PERIOD_MS) {
+    // Maximum number of callbacks already installed, or period too long!
+    return CALLBACK_NOT_INSTALLED;
+  }
+
+#if BUTTON_EXECUTOR_SCHEDULABILITY_CHECK
+  // Check the task set with the new callback, if asked to
+  if (wcetInMicros > 0 && _schedulabilityCheck != SCHEDULABILITY_CHECK_OFF
+      && !isSchedulable(periodInMs, wcetInMicros)
+      && _schedulabilityCheck == SCHEDULABILITY_CHECK_REJECT) {
+    return CALLBACK_NOT_SCHEDULABLE;
+  }
+#else
+  (void)wcetInMicros;
+#endif
     
-    // Register the callback, store and return the reference
-    _callbackReferences[index] = _timer.every(periodInMs, callback);
-    return _callbackReferences[index];
+  // Register the callback, the index is the reference
+  if (!scheduleCallback(index, periodInMs, periodInMs, callback)) {
+    // The scheduler has no room left for it
+    return CALLBACK_NOT_INSTALLED;
   }
-  
-  // Maximum number of callbacks already installed!
-  return CALLBACK_NOT_INSTALLED;
+#if BUTTON_EXECUTOR_SCHEDULABILITY_CHECK
+  _slots[index].wcetInMicros = wcetInMicros;
+#endif
+  return index;
+}
+
+int8_t ButtonExecutor::callbackEveryByHertz(unsigned long periodInHz,
+    void (*callback)(void)) {
+  return this->callbackEveryByHertz(periodInHz, callback, 0);
 }
 
 int8_t ButtonExecutor::callbackEveryByHertz(unsigned long periodInHz,
+    void (*callback)(void), unsigned long wcetInMicros) {
+  // Convert frequency in hertz to milliseconds
+  int callbackMillis = (1000/periodInHz);
+  return this->callbackEveryByMillis(callbackMillis, callback, wcetInMicros);
+}
+
+int8_t ButtonExecutor::callbackEveryByMicros(DispatchTimer* timer,
+    unsigned long periodInMicros, void (*callback)(void)) {
+#if BUTTON_EXECUTOR_DISPATCH_TIMERS > 0
+  // Reuse the entry of the same timer, or else take the first free one
+  int entry = -1;
+  for(int index = 0; index < BUTTON_EXECUTOR_DISPATCH_TIMERS; index++) {
+    if (_dispatchTimers[index] == timer) {
+      entry = index;
+      break;
+    }
+    if (entry < 0 && !_dispatchTimers[index]) {
+      entry = index;
+    }
+  }
+  if (entry < 0) {
+    // Maximum number of timers already registered!
+    return CALLBACK_NOT_INSTALLED;
+  }
+
+  if (!timer->start(periodInMicros, callback)) {
+    // Period the timer can not generate! A timer that was already registered
+    // may still be running with its old period.
+    if (_dispatchTimers[entry] == timer) {
+      timer->stop();
+      _dispatchTimers[entry] = NULL;
+    }
+    return CALLBACK_NOT_INSTALLED;
+  }
+
+  // The ids of the timers follow the ids of the scheduled callbacks
+  _dispatchTimers[entry] = timer;
+  return MAX_NUMBER_OF_CALLBACKS + entry;
+#else
+  (void)timer;
+  (void)periodInMicros;
+  (void)callback;
+  return CALLBACK_NOT_INSTALLED;
+#endif
+}
+
+int8_t ButtonExecutor::callbackEveryByMillisOnCore(unsigned long periodInMs,
+    void (*callback)(void), uint8_t core) {
+  if (core == MAIN_CORE) {
+    return this->callbackEveryByMillis(periodInMs, callback);
+  }
+
+#if BUTTON_EXECUTOR_CORE_CALLBACKS > 0
+  if (core == SECOND_CORE && periodInMs <= MAX_PERIOD_MS) {
+    // Only entries that the second core has released can be reused
+    for(int entry = 0; entry < BUTTON_EXECUTOR_CORE_CALLBACKS; entry++) {
+      uint8_t requests = _coreRequests[entry];
+      if ((requests & 1) || requests != _coreApplied[entry]) {
+        continue;
+      }
+
+      // Write the callback before the second core can see the request
+      _coreCallbacks[entry] = callback;
+      _corePeriods[entry] = periodInMs;
+      __sync_synchronize();
+      _coreRequests[entry] = requests + 1;
+      return FIRST_CORE_CALLBACK_ID + entry;
+    }
+  }
+#endif
+
+  // Maximum number of callbacks already installed, or no such core!
+  return CALLBACK_NOT_INSTALLED;
+}
+
+int8_t ButtonExecutor::callbackEveryByHertzOnCore(unsigned long periodInHz,
+    void (*callback)(void), uint8_t core) {
+  // Convert frequency in hertz to milliseconds
+  int callbackMillis = (1000/periodInHz);
+  return this->callbackEveryByMillisOnCore(callbackMillis, callback, core);
+}
+
+int8_t ButtonExecutor::persistentCallbackEveryByMillis(unsigned long periodInMs,
+    void (*callback)(void)) {
+
+  // Reserve a slot, its index is the reference on every run
+  int index = findFreeSlot();
+  if (index < 0 || periodInMs > MAX_PERIOD_MS) {
+    // Maximum number of callbacks already installed, or period too long!
+    return CALLBACK_NOT_INSTALLED;
+  }
+
+  // Store the declaration in the slot, it is armed on every start of execution
+  _slots[index].callback = callback;
+  _slots[index].period = periodInMs;
+  setSlot(_persistentSlots, index);
+  return index;
+}
+
+int8_t ButtonExecutor::persistentCallbackEveryByHertz(unsigned long periodInHz,
     void (*callback)(void)) {
   // Convert frequency in hertz to milliseconds
   int callbackMillis = (1000/periodInHz);
-  return this->callbackEveryByMillis(callbackMillis, callback);
+  return this->persistentCallbackEveryByMillis(callbackMillis, callback);
 }
   
 
+int8_t ButtonExecutor::callbackOnPinEdge(uint8_t pin, uint8_t edge,
+    void (*callback)(void)) {
+#if BUTTON_EXECUTOR_WATCHES > 0
+  if (_numberOfWatches >= BUTTON_EXECUTOR_WATCHES) {
+    // Maximum number of pin callbacks already declared!
+    return CALLBACK_NOT_INSTALLED;
+  }
+
+  // Store the declaration, it is armed on every start of execution
+  _watches[_numberOfWatches].callback = callback;
+  _watches[_numberOfWatches].pin = pin;
+  _watches[_numberOfWatches].edge = edge;
+  return FIRST_WATCH_ID + _numberOfWatches++;
+#else
+  (void)pin;
+  (void)edge;
+  (void)callback;
+  return CALLBACK_NOT_INSTALLED;
+#endif
+}
+
+int8_t ButtonExecutor::callbackWhen(boolean (*predicate)(void),
+    unsigned long periodInMs, void (*callback)(void)) {
+#if BUTTON_EXECUTOR_CONDITIONS > 0
+  return declareCondition(predicate, periodInMs, callback, false);
+#else
+  (void)predicate;
+  (void)periodInMs;
+  (void)callback;
+  return CALLBACK_NOT_INSTALLED;
+#endif
+}
+
+int8_t ButtonExecutor::callbackOnceWhen(boolean (*predicate)(void),
+    unsigned long periodInMs, void (*callback)(void)) {
+#if BUTTON_EXECUTOR_CONDITIONS > 0
+  return declareCondition(predicate, periodInMs, callback, true);
+#else
+  (void)predicate;
+  (void)periodInMs;
+  (void)callback;
+  return CALLBACK_NOT_INSTALLED;
+#endif
+}
+
+void ButtonExecutor::usePinInterrupts(boolean isUsingInterrupts) {
+#if BUTTON_EXECUTOR_WATCHES > 0
+  _isUsingPinInterrupts = isUsingInterrupts;
+#else
+  (void)isUsingInterrupts;
+#endif
+}
+
+void ButtonExecutor::setCyclicExecutive(boolean isCyclic) {
+  _isCyclicExecutive = isCyclic;
+}
+
+unsigned long ButtonExecutor::getMinorFrame() {
+  return _isCyclic ? _minorFrameMs : 0;
+}
+
+unsigned long ButtonExecutor::getMajorFrame() {
+  return _isCyclic ? _majorFrameMs : 0;
+}
+
+unsigned long ButtonExecutor::getFrameOverruns() {
+  return _frameOverruns;
+}
+
+void ButtonExecutor::printFrameTable() {
+#if BUTTON_EXECUTOR_CYCLIC_FRAMES > 0
+  if (!_printer || !_isCyclic) {
+    return;
+  }
+
+  _printer->println(F("*** Frame table (time_ms callbacks)"));
+  for(uint16_t frame = 1; frame <= _numberOfFrames; frame++) {
+    _printer->print(frame * _minorFrameMs);
+    for(int index = 0; index < MAX_NUMBER_OF_CALLBACKS; index++) {
+      if (isSlotSet(_frames[frame % _numberOfFrames], index)) {
+        _printer->print(' ');
+        _printer->print(index);
+      }
+    }
+    _printer->println();
+  }
+#endif
+}
+
+void ButtonExecutor::setStaticTasks(const StaticTask* tasks,
+    uint8_t numberOfTasks) {
+  _staticTasks = tasks;
+  _numberOfStaticTasks = numberOfTasks;
+}
+
 int8_t ButtonExecutor::stopCallback(int8_t callbackId) {
+#if BUTTON_EXECUTOR_DISPATCH_TIMERS > 0
+  // Timers are stopped right away, even while dispatching
+  int entry = callbackId - MAX_NUMBER_OF_CALLBACKS;
+  if (entry >= 0 && entry < BUTTON_EXECUTOR_DISPATCH_TIMERS) {
+    if (!_dispatchTimers[entry]) {
+      return CALLBACK_NOT_INSTALLED;
+    }
+    _dispatchTimers[entry]->stop();
+    _dispatchTimers[entry] = NULL;
+    return CALLBACK_STOPPED;
+  }
+#endif
 
-  // Find the callback id in the stored references
-  for(int index = 0; index < MAX_NUMBER_OF_CALLBACKS; index++) {
-	  if (_callbackReferences[index] != callbackId) {
-		  continue;
-	  }
-	  
-	  // Stop the callback, clear the stored reference
-    _timer.stop(callbackId);
-	  _callbackReferences[index] = TIMER_NOT_AN_EVENT;
-	  return CALLBACK_STOPPED;
+#if BUTTON_EXECUTOR_CORE_CALLBACKS > 0
+  // Callbacks of the second core are stopped by its next pass
+  int coreEntry = callbackId - FIRST_CORE_CALLBACK_ID;
+  if (coreEntry >= 0 && coreEntry < BUTTON_EXECUTOR_CORE_CALLBACKS) {
+    if (!(_coreRequests[coreEntry] & 1)) {
+      return CALLBACK_NOT_INSTALLED;
+    }
+    _coreRequests[coreEntry]++;
+    return CALLBACK_STOPPED;
   }
-  
-  // The callback id not found
+#endif
+
+  // The callback id must match a registered callback
+  if (callbackId < 0 || callbackId >= MAX_NUMBER_OF_CALLBACKS
+      || !isSlotSet(_occupiedSlots, callbackId)
+      || isSlotSet(_stopPendingSlots, callbackId)) {
+    return CALLBACK_NOT_INSTALLED;
+  }
+#if BUTTON_EXECUTOR_DRAIN_CALLBACKS
+  _slots[callbackId].drainCallback = NULL;
+#endif
+
+  // While dispatching, keep the slot until the end of the pass
+  if (_isDispatching) {
+    setSlot(_stopPendingSlots, callbackId);
+    _hasPendingChanges = true;
+    return CALLBACK_STOPPED;
+  }
+
+  // Stop the callback, clear the stored reference
+  _timer.stop(_slots[callbackId].reference);
+  freeSlot(callbackId);
+  return CALLBACK_STOPPED;
+}
+
+int8_t ButtonExecutor::setDrainCallback(int8_t callbackId,
+    boolean (*drainCallback)(void)) {
+#if BUTTON_EXECUTOR_DRAIN_CALLBACKS
+  // The callback id must match a registered callback
+  if (callbackId < 0 || callbackId >= MAX_NUMBER_OF_CALLBACKS
+      || !isSlotSet(_occupiedSlots, callbackId)
+      || isSlotSet(_stopPendingSlots, callbackId)) {
+    return CALLBACK_NOT_INSTALLED;
+  }
+
+  _slots[callbackId].drainCallback = drainCallback;
+  return callbackId;
+#else
+  (void)callbackId;
+  (void)drainCallback;
   return CALLBACK_NOT_INSTALLED;
+#endif
+}
+
+boolean ButtonExecutor::registerSampleBuffer(SampleBufferBase* buffer,
+    void (*consumer)(void)) {
+#if BUTTON_EXECUTOR_SAMPLE_BUFFERS > 0
+  if (_numberOfSampleBuffers >= BUTTON_EXECUTOR_SAMPLE_BUFFERS) {
+    // Maximum number of buffers already registered!
+    return false;
+  }
+
+  _sampleBuffers[_numberOfSampleBuffers] = buffer;
+  _sampleConsumers[_numberOfSampleBuffers] = consumer;
+  _numberOfSampleBuffers++;
+  return true;
+#else
+  (void)buffer;
+  (void)consumer;
+  return false;
+#endif
+}
+
+void ButtonExecutor::setGracefulStopTimeout(unsigned long timeoutInMs) {
+  _gracefulStopTimeoutMs = timeoutInMs;
+}
+
+void ButtonExecutor::setRunLimits(unsigned long maxDurationInMs) {
+  this->setRunLimits(maxDurationInMs, NULL, 0);
+}
+
+void ButtonExecutor::setRunLimits(unsigned long maxDurationInMs,
+    void (*countedCallback)(void), unsigned long maxInvocations) {
+  _maxDurationMs = maxDurationInMs;
+  _countedCallback = countedCallback;
+  _maxInvocations = maxInvocations;
+}
+
+void ButtonExecutor::setSchedulabilityCheck(uint8_t policy) {
+#if BUTTON_EXECUTOR_SCHEDULABILITY_CHECK
+  _schedulabilityCheck = policy;
+#else
+  (void)policy;
+#endif
+}
+
+void ButtonExecutor::setClock(unsigned long (*clockMillis)(void),
+    unsigned long (*clockMicros)(void)) {
+  _clockMillis = clockMillis;
+  _clockMicros = clockMicros;
+#ifdef SCHEDULER_HAS_CLOCK
+  _timer.setClock(clockMillis);
+#if BUTTON_EXECUTOR_CORE_CALLBACKS > 0
+  _coreTimer.setClock(clockMillis);
+#endif
+#endif
+}
+
+void ButtonExecutor::setPinReader(int (*readPin)(uint8_t pin)) {
+  _readPin = readPin;
+}
+
+void ButtonExecutor::setWatchdog(void (*feedWatchdog)(void),
+    unsigned long maxPassInMicros) {
+  _feedWatchdog = feedWatchdog;
+  _maxPassMicros = maxPassInMicros;
+}
+
+int8_t ButtonExecutor::getResetCallbackId() {
+  return _resetCallbackId;
+}
+
+void ButtonExecutor::setProfiling(boolean isProfiling) {
+#if BUTTON_EXECUTOR_PROFILE_SIZE > 0
+  _isProfiling = isProfiling;
+  clearProfile();
+#else
+  (void)isProfiling;
+#endif
+}
+
+void ButtonExecutor::printProfile() {
+#if BUTTON_EXECUTOR_PROFILE_SIZE > 0
+  printProfileTable();
+#endif
+}
+
+void ButtonExecutor::enableLoadMonitor(unsigned long windowInMs,
+    unsigned long reportIntervalInMs) {
+#if BUTTON_EXECUTOR_LOAD_SUBWINDOWS > 0
+  for(int index = 0; index < BUTTON_EXECUTOR_LOAD_SUBWINDOWS; index++) {
+    _loadBusyMicros[index] = 0;
+    _loadElapsedMicros[index] = 0;
+    _loadLoops[index] = 0;
+  }
+  _loadSubwindow = 0;
+  _loadSubwindowStartTime = nowMicros();
+  _lastLoadReportTime = nowMillis();
+  _loadPercent = 0;
+  _loopFrequency = 0;
+  _loadReportIntervalMs = reportIntervalInMs;
+  _loadWindowMs = windowInMs;
+#else
+  (void)windowInMs;
+  (void)reportIntervalInMs;
+#endif
+}
+
+float ButtonExecutor::getLoadPercent() {
+#if BUTTON_EXECUTOR_LOAD_SUBWINDOWS > 0
+  return _loadPercent;
+#else
+  return 0;
+#endif
+}
+
+unsigned long ButtonExecutor::getLoopFrequency() {
+#if BUTTON_EXECUTOR_LOAD_SUBWINDOWS > 0
+  return _loopFrequency;
+#else
+  return 0;
+#endif
+}
+
+void ButtonExecutor::useButtonInterrupt(boolean isUsingInterrupt) {
+  _isUsingButtonInterrupt = isUsingInterrupt;
+}
+
+uint16_t ButtonExecutor::getLatencyCount(uint8_t latencyType,
+    uint8_t bucket) {
+#if BUTTON_EXECUTOR_LATENCY_BUCKETS > 0
+  if (latencyType > LATENCY_STOP || bucket >= BUTTON_EXECUTOR_LATENCY_BUCKETS) {
+    return 0;
+  }
+  return _latencyHistogram[latencyType][bucket];
+#else
+  (void)latencyType;
+  (void)bucket;
+  return 0;
+#endif
+}
+
+void ButtonExecutor::printLatencyHistogram() {
+#if BUTTON_EXECUTOR_LATENCY_BUCKETS > 0
+  if (!_printer) {
+    return;
+  }
+
+  for(uint8_t latencyType = LATENCY_START; latencyType <= LATENCY_STOP;
+      latencyType++) {
+    _printer->println(latencyType == LATENCY_START
+      ? F("*** Start latency (microseconds, count)")
+      : F("*** Stop latency (microseconds, count)"));
+    for(uint8_t bucket = 0; bucket < BUTTON_EXECUTOR_LATENCY_BUCKETS;
+        bucket++) {
+      if (_latencyHistogram[latencyType][bucket] == 0) {
+        continue;
+      }
+      _printer->print(bucket ? 1UL << bucket : 0UL);
+      _printer->print(' ');
+      _printer->println(_latencyHistogram[latencyType][bucket]);
+    }
+  }
+#endif
+}
+
+void ButtonExecutor::clearLatencyHistogram() {
+#if BUTTON_EXECUTOR_LATENCY_BUCKETS > 0
+  memset(_latencyHistogram, 0, sizeof(_latencyHistogram));
+#endif
+}
+
+void ButtonExecutor::setAsyncLogging(boolean isAsync) {
+#if BUTTON_EXECUTOR_LOG_BUFFER_SIZE > 0
+  // Write out what is still buffered when going back to synchronous
+  if (_isAsyncLogging && !isAsync && _printer) {
+    _logBuffer.drainTo(_printer, BUTTON_EXECUTOR_LOG_BUFFER_SIZE);
+  }
+  _isAsyncLogging = isAsync;
+#else
+  (void)isAsync;
+#endif
+}
+
+void ButtonExecutor::setLogMessageIds(boolean isLoggingIds) {
+  _isLoggingIds = isLoggingIds;
+}
+
+unsigned long ButtonExecutor::getDroppedLogMessages() {
+#if BUTTON_EXECUTOR_LOG_BUFFER_SIZE > 0
+  return _logBuffer.getDroppedMessages();
+#else
+  return 0;
+#endif
+}
+
+uint16_t ButtonExecutor::getTrace(TraceEvent* events, uint16_t maxEvents) {
+#if BUTTON_EXECUTOR_TRACE_SIZE > 0
+  uint16_t count = min(maxEvents, _traceCount);
+  uint16_t oldest = (_traceHead + BUTTON_EXECUTOR_TRACE_SIZE - _traceCount)
+    % BUTTON_EXECUTOR_TRACE_SIZE;
+  for(uint16_t index = 0; index < count; index++) {
+    events[index] = _trace[(oldest + index) % BUTTON_EXECUTOR_TRACE_SIZE];
+  }
+  return count;
+#else
+  (void)events;
+  (void)maxEvents;
+  return 0;
+#endif
+}
+
+void ButtonExecutor::dumpTrace() {
+#if BUTTON_EXECUTOR_TRACE_SIZE > 0
+  if (!_printer) {
+    return;
+  }
+
+  _printer->println(F("*** Trace (timestamp type callback duration)"));
+  TraceEvent event;
+  uint16_t oldest = (_traceHead + BUTTON_EXECUTOR_TRACE_SIZE - _traceCount)
+    % BUTTON_EXECUTOR_TRACE_SIZE;
+  for(uint16_t index = 0; index < _traceCount; index++) {
+    event = _trace[(oldest + index) % BUTTON_EXECUTOR_TRACE_SIZE];
+    _printer->print(event.timestamp);
+    _printer->print(' ');
+    _printer->print((const __FlashStringHelper*)
+      pgm_read_ptr(&TRACE_TYPE_NAMES[event.type]));
+    _printer->print(' ');
+    _printer->print(event.callbackId);
+    _printer->print(' ');
+    _printer->println(event.duration);
+  }
+#endif
+}
+
+void ButtonExecutor::clearTrace() {
+#if BUTTON_EXECUTOR_TRACE_SIZE > 0
+  _traceHead = 0;
+  _traceCount = 0;
+#endif
+}
+
+uint8_t ButtonExecutor::getNumberOfCallbacks() {
+  uint8_t numberOfCallbacks = 0;
+  for(unsigned int word = 0; word < SLOT_WORDS; word++) {
+    numberOfCallbacks += __builtin_popcountl(_occupiedSlots[word]);
+  }
+  return numberOfCallbacks;
+}
+
+boolean ButtonExecutor::checkIntegrity() {
+  // Outside of dispatching, all changes must have been applied
+  if (!_isDispatching && (_isStopPending || _hasPendingChanges)) {
+    return false;
+  }
+
+  uint8_t numberOfCyclicCallbacks = 0;
+  for(int index = 0; index < MAX_NUMBER_OF_CALLBACKS; index++) {
+    int8_t reference = _slots[index].reference;
+    if (isSlotSet(_occupiedSlots, index)
+        != (reference != SCHEDULER_NOT_AN_EVENT)) {
+      return false;
+    }
+    if (reference == SCHEDULER_NOT_AN_EVENT) {
+      // A free slot can not have a drain callback or a pending stop
+      if (isSlotSet(_stopPendingSlots, index)) {
+        return false;
+      }
+#if BUTTON_EXECUTOR_PHASES
+      if (isSlotSet(_phaseSlots, index)) {
+        return false;
+      }
+#endif
+#if BUTTON_EXECUTOR_DRAIN_CALLBACKS
+      if (_slots[index].drainCallback) {
+        return false;
+      }
+#endif
+      continue;
+    }
+    if (reference == PENDING_REFERENCE && _isDispatching) {
+      continue;
+    }
+    if (reference == CYCLIC_REFERENCE && _isCyclic) {
+      numberOfCyclicCallbacks++;
+      continue;
+    }
+
+    // A registered callback must have a valid and unique reference
+    if (reference < 0 || reference >= SCHEDULER_MAX_EVENTS
+        || !_slots[index].callback) {
+      return false;
+    }
+    for(int other = index + 1; other < MAX_NUMBER_OF_CALLBACKS; other++) {
+      if (_slots[other].reference == reference) {
+        return false;
+      }
+    }
+  }
+
+#if BUTTON_EXECUTOR_SCHEDULER != BUTTON_EXECUTOR_TIMER_SCHEDULER
+  // Every scheduled event is either a callback or the button check
+  if (!_isDispatching && _timer.getNumberOfEvents()
+      != getNumberOfCallbacks() - numberOfCyclicCallbacks + 1) {
+    return false;
+  }
+#endif
+  return true;
 }
 
 void ButtonExecutor::abortExecution() {
-  printMsg("*** Aborting execution by request!");
+  printMsg(MSG_ABORTING);
   stopExecution();
 }
 
@@ -119,9 +1303,32 @@ void ButtonExecutor::abortExecution() {
  * button.
  */
 void checkButton(void) {
-  int currentButtonState = digitalRead(_buttonPin);
-  if (currentButtonState == _expectedButtonPressState 
-        && currentButtonState != _oldButtonState) {
+  int currentButtonState = (*(_readPin))(_buttonPin);
+  unsigned long now = nowMicros();
+
+  // Take the first edge seen by the interrupt, if any, as the time of a
+  // change. Edges older than two checks without a change were just noise.
+  noInterrupts();
+  boolean isButtonEdgePending = _isButtonEdgePending;
+  unsigned long buttonEdgeMicros = _buttonEdgeMicros;
+  if (currentButtonState != _oldButtonState || (isButtonEdgePending
+      && now - buttonEdgeMicros > 2000UL * BUTTON_INTERVAL_MS)) {
+    _isButtonEdgePending = false;
+  }
+  interrupts();
+
+  if (currentButtonState != _oldButtonState) {
+    traceEvent(currentButtonState == _expectedButtonPressState
+      ? TRACE_BUTTON_PRESS : TRACE_BUTTON_RELEASE, SCHEDULER_NOT_AN_EVENT, 0);
+#if BUTTON_EXECUTOR_LATENCY_BUCKETS > 0
+    if (currentButtonState == _expectedButtonPressState) {
+      _latencyEdgeMicros = isButtonEdgePending ? buttonEdgeMicros : now;
+      _hasLatencyEdge = true;
+    }
+#endif
+  }
+  if (isEdgeOf(_expectedButtonPressState == HIGH ? RISING : FALLING,
+      _oldButtonState, currentButtonState)) {
 	  if (!_isExecuting) {
 		  startExecution();
 	  } else {
@@ -131,6 +1338,255 @@ void checkButton(void) {
   _oldButtonState = currentButtonState;
 }
 
+/**
+ * This is an internal static method that is attached to the button pin
+ * interrupt when enabled. It only timestamps the first edge, the button is
+ * still debounced by checkButton.
+ */
+void buttonEdgeInterrupt(void) {
+  if (!_isButtonEdgePending) {
+    _buttonEdgeMicros = nowMicros();
+    _isButtonEdgePending = true;
+  }
+}
+
+/**
+ * This is an internal static method that returns true if a pin going from
+ * oldLevel to level is an edge of the given type, RISING, FALLING or CHANGE.
+ * It detects the presses of the button as well as the edges of watched pins.
+ */
+boolean isEdgeOf(uint8_t edge, int oldLevel, int level) {
+  if (level == oldLevel) {
+    return false;
+  }
+  return edge == CHANGE || (edge == RISING) == (level == HIGH);
+}
+
+/**
+ * This is an internal static method that arms the declared pin and condition
+ * callbacks when execution is started. The current level of every pin, and
+ * the current value of every predicate, is what edges are detected from.
+ * Pins are attached to an interrupt if asked to, otherwise their ports are
+ * looked up for checkWatches, unless the pins are read by a replaced pin
+ * reader.
+ */
+void armWatches(void) {
+#if BUTTON_EXECUTOR_WATCHES > 0
+#ifdef WATCH_PORTS
+  _numberOfWatchPorts = 0;
+#endif
+  for(uint8_t index = 0; index < _numberOfWatches; index++) {
+    Watch& watch = _watches[index];
+    watch.isInterrupt = false;
+    watch.level = (*(_readPin))(watch.pin);
+
+#ifdef NOT_AN_INTERRUPT
+    if (_isUsingPinInterrupts
+        && digitalPinToInterrupt(watch.pin) != NOT_AN_INTERRUPT) {
+      _isWatchEdgePending[index] = false;
+      attachInterrupt(digitalPinToInterrupt(watch.pin),
+        (void (*)(void))pgm_read_ptr(&WATCH_INTERRUPTS.table[index]),
+        watch.edge);
+      watch.isInterrupt = true;
+      continue;
+    }
+#endif
+
+#ifdef WATCH_PORTS
+    // Pins on the same port share a single read of the port
+    watch.portIndex = NO_WATCH_PORT;
+    if (_readPin == readButtonPin) {
+      WatchPort port =
+        (WatchPort)portInputRegister(digitalPinToPort(watch.pin));
+      uint8_t portIndex = 0;
+      while (portIndex < _numberOfWatchPorts
+          && _watchPorts[portIndex] != port) {
+        portIndex++;
+      }
+      if (portIndex == _numberOfWatchPorts) {
+        _watchPorts[_numberOfWatchPorts++] = port;
+      }
+      watch.portIndex = portIndex;
+      watch.mask = digitalPinToBitMask(watch.pin);
+    }
+#endif
+  }
+  _areWatchesArmed = _numberOfWatches > 0;
+#endif
+
+#if BUTTON_EXECUTOR_CONDITIONS > 0
+  // A condition that is already true is not an edge
+  unsigned long now = nowMillis();
+  for(uint8_t index = 0; index < _numberOfConditions; index++) {
+    Condition& condition = _conditions[index];
+    condition.isTrue = (*(condition.predicate))();
+    condition.isSpent = false;
+    condition.lastCheckTime = now;
+  }
+  _areConditionsArmed = _numberOfConditions > 0;
+#endif
+}
+
+/**
+ * This is an internal static method that disarms the pin and condition
+ * callbacks as soon as execution is stopped.
+ */
+void disarmWatches(void) {
+#if BUTTON_EXECUTOR_WATCHES > 0
+  if (_areWatchesArmed) {
+    for(uint8_t index = 0; index < _numberOfWatches; index++) {
+      if (_watches[index].isInterrupt) {
+        detachInterrupt(digitalPinToInterrupt(_watches[index].pin));
+      }
+    }
+    _areWatchesArmed = false;
+  }
+#endif
+#if BUTTON_EXECUTOR_CONDITIONS > 0
+  _areConditionsArmed = false;
+#endif
+}
+
+#if BUTTON_EXECUTOR_WATCHES > 0
+/**
+ * This is an internal static method that is called on every pass of the loop
+ * method while the pin callbacks are armed. All ports are read first, so the
+ * pins are seen at the same time, then the callback of every pin that has an
+ * edge is called, with the same bookkeeping as the scheduled callbacks.
+ * Callbacks stop being called as soon as one of them stops execution.
+ */
+void checkWatches(void) {
+#ifdef WATCH_PORTS
+  WatchMask portLevels[BUTTON_EXECUTOR_WATCHES];
+  for(uint8_t portIndex = 0; portIndex < _numberOfWatchPorts; portIndex++) {
+    portLevels[portIndex] = *(_watchPorts[portIndex]);
+  }
+#endif
+
+  for(uint8_t index = 0; index < _numberOfWatches; index++) {
+    if (!_areWatchesArmed || _isStopPending) {
+      return;
+    }
+
+    Watch& watch = _watches[index];
+    boolean isEdge;
+    if (watch.isInterrupt) {
+      noInterrupts();
+      isEdge = _isWatchEdgePending[index];
+      _isWatchEdgePending[index] = false;
+      interrupts();
+    } else {
+      int level;
+#ifdef WATCH_PORTS
+      if (watch.portIndex != NO_WATCH_PORT) {
+        level = (portLevels[watch.portIndex] & watch.mask) ? HIGH : LOW;
+      } else {
+        level = (*(_readPin))(watch.pin);
+      }
+#else
+      level = (*(_readPin))(watch.pin);
+#endif
+      isEdge = isEdgeOf(watch.edge, watch.level, level);
+      watch.level = level;
+    }
+    if (isEdge) {
+      callCallback(FIRST_WATCH_ID + index, watch.callback);
+    }
+  }
+}
+
+/**
+ * This is an internal static method that is attached to the interrupt of a
+ * watched pin when pin interrupts are used. It only latches the edge, the
+ * callback is called by checkWatches.
+ */
+void watchEdgeInterrupt(int watch) {
+  _isWatchEdgePending[watch] = true;
+}
+#endif
+
+#if BUTTON_EXECUTOR_CONDITIONS > 0
+/**
+ * This is an internal static method that is called on every pass of the loop
+ * method while the condition callbacks are armed. The predicates that are due
+ * are evaluated against the same time, and the callback of every condition
+ * that became true is called, with the same bookkeeping as the scheduled
+ * callbacks. Callbacks stop being called as soon as one of them stops
+ * execution.
+ */
+void checkConditions(void) {
+  unsigned long now = nowMillis();
+
+  for(uint8_t index = 0; index < _numberOfConditions; index++) {
+    if (!_areConditionsArmed || _isStopPending) {
+      return;
+    }
+
+    Condition& condition = _conditions[index];
+    unsigned long elapsed = now - condition.lastCheckTime;
+    if (condition.isSpent || elapsed < condition.periodInMs) {
+      continue;
+    }
+    // Keep the rate when passes are late, without catching up
+    if (condition.periodInMs > 0) {
+      condition.lastCheckTime = now - elapsed % condition.periodInMs;
+    }
+
+    boolean wasTrue = condition.isTrue;
+    condition.isTrue = (*(condition.predicate))();
+    if (condition.isTrue && !wasTrue) {
+      condition.isSpent = condition.isOneShot;
+      callCallback(FIRST_CONDITION_ID + index, condition.callback);
+    }
+  }
+}
+
+/**
+ * This is an internal static method that stores the declaration of a
+ * condition callback, it is armed on every start of execution.
+ */
+int8_t declareCondition(boolean (*predicate)(void), unsigned long periodInMs,
+    void (*callback)(void), boolean isOneShot) {
+
+  if (_numberOfConditions >= BUTTON_EXECUTOR_CONDITIONS) {
+    // Maximum number of condition callbacks already declared!
+    return CALLBACK_NOT_INSTALLED;
+  }
+
+  _conditions[_numberOfConditions].callback = callback;
+  _conditions[_numberOfConditions].predicate = predicate;
+  _conditions[_numberOfConditions].periodInMs = periodInMs;
+  _conditions[_numberOfConditions].isOneShot = isOneShot;
+  return FIRST_CONDITION_ID + _numberOfConditions++;
+}
+#endif
+
+/**
+ * This is an internal static method that adds the time from the last button
+ * press to startTime to the log2 bucketed latency histogram. Starts and stops
+ * that were not caused by the button are not recorded.
+ */
+void recordLatency(uint8_t latencyType, unsigned long startTime) {
+#if BUTTON_EXECUTOR_LATENCY_BUCKETS > 0
+  if (!_hasLatencyEdge) {
+    return;
+  }
+  _hasLatencyEdge = false;
+
+  unsigned long latency = startTime - _latencyEdgeMicros;
+  uint8_t bucket = 0;
+  while ((latency >>= 1) && bucket < BUTTON_EXECUTOR_LATENCY_BUCKETS - 1) {
+    bucket++;
+  }
+  if (_latencyHistogram[latencyType][bucket] < 0xFFFF) {
+    _latencyHistogram[latencyType][bucket]++;
+  }
+#else
+  (void)latencyType;
+  (void)startTime;
+#endif
+}
+
 /**
  * This is an internal static method that is used to start the execution of the
  * code. It calls the sketchStartCallback that was registered in the
@@ -142,42 +1598,968 @@ void startExecution(void) {
 	  return;
   }
   
-  printMsg("*** Starting execution");
+  printMsg(MSG_STARTING);
+
+  _invocations = 0;
+  _executionStartTime = nowMillis();
+
+#if BUTTON_EXECUTOR_SAMPLE_BUFFERS > 0
+  // Nothing is left from the last run
+  for(uint8_t buffer = 0; buffer < _numberOfSampleBuffers; buffer++) {
+    _sampleBuffers[buffer]->clear();
+  }
+#endif
+#if BUTTON_EXECUTOR_PROFILE_SIZE > 0
+  if (_isProfiling) {
+    clearProfile();
+  }
+#endif
+
+  // Arm the static tasks first, in the order of their table. Every task
+  // that can not be armed is reported, like callbackEveryByMillis rejects it.
+  StaticTask task;
+  for(uint8_t staticTask = 0; staticTask < _numberOfStaticTasks;
+      staticTask++) {
+    int index = findFreeSlot();
+    if (index < 0) {
+      printMsg(MSG_STATIC_TASK_DROPPED, staticTask);
+      continue;
+    }
+    memcpy_P(&task, &_staticTasks[staticTask], sizeof(task));
+    if (task.periodInMs > MAX_PERIOD_MS
+        || !scheduleCallback(index, task.periodInMs, task.phaseInMs,
+          task.callback)) {
+      printMsg(MSG_NOT_SCHEDULED, index);
+    }
+  }
+
+  // Arm the persistent callbacks in their reserved slots
+  for(int index = 0; index < MAX_NUMBER_OF_CALLBACKS; index++) {
+    if (isSlotSet(_persistentSlots, index)) {
+      if (!scheduleCallback(index, _slots[index].period,
+          _slots[index].period, _slots[index].callback)) {
+        printMsg(MSG_NOT_SCHEDULED, index);
+      }
+    }
+  }
   
+  unsigned long startTime = nowMicros();
+  recordLatency(LATENCY_START, startTime);
   (*(_sketchStartCallback))();
+  traceEvent(TRACE_START, SCHEDULER_NOT_AN_EVENT, startTime);
   _isExecuting = true;
+
+  // The sketch has set up its pins by now
+  armWatches();
+
+  // Build the frame table at the end of the pass, with all the callbacks
+  _frameOverruns = 0;
+  if (_isCyclicExecutive) {
+    _isFrameTablePending = true;
+    _hasPendingChanges = true;
+  }
 }
 
 /**
  * This is an internal static method that is used to stop the execution of the
- * code. It stops all registered callbacks and then calls the sketchStopCallback
- * method that was registered in the ButtonExecutor.setup method.
+ * code. It stops all registered callbacks and then, if a graceful stop timeout
+ * is set and drain callbacks are registered, starts draining. Otherwise it
+ * finishes the execution right away.
  */
 void stopExecution(void) {
-  // If not executing, then just return
-  if (!_isExecuting) {
+  // If not executing or already draining, then just return
+  if (!_isExecuting || _isDraining) {
 	  return;
   }
+
+  // The timers, pins and second core do not wait for the end of the pass
+  // or for draining
+  stopDispatchTimers();
+  disarmWatches();
+  stopCoreCallbacks();
   
-	printMsg("*** Stopping execution");
+  // While dispatching, stop at the end of the pass
+  if (_isDispatching) {
+    _isStopPending = true;
+    return;
+  }
+
+	printMsg(MSG_STOPPING);
 	
-  // Stop execution of all registered callbacks
+  // Stop execution of all registered callbacks, only the occupied slots
+  boolean hasDrainCallbacks = false;
+  for(unsigned int word = 0; word < SLOT_WORDS; word++) {
+    unsigned long slots = _occupiedSlots[word];
+    while (slots) {
+      int index = word * SLOT_WORD_BITS + __builtin_ctzl(slots);
+      slots &= slots - 1;
+      _timer.stop(_slots[index].reference);
+      _slots[index].reference = SCHEDULER_NOT_AN_EVENT;
+
+#if BUTTON_EXECUTOR_DRAIN_CALLBACKS
+      // Without a graceful stop timeout the cleanups are skipped
+      if (_slots[index].drainCallback) {
+        if (_gracefulStopTimeoutMs > 0) {
+          hasDrainCallbacks = true;
+        } else {
+          _slots[index].drainCallback = NULL;
+        }
+      }
+#endif
+    }
+    _occupiedSlots[word] = 0;
+    _stopPendingSlots[word] = 0;
+#if BUTTON_EXECUTOR_PHASES
+    _phaseSlots[word] = 0;
+#endif
+  }
+  _isCyclic = false;
+  _isFrameTablePending = false;
+#if BUTTON_EXECUTOR_CYCLIC_FRAMES > 0 && BUTTON_EXECUTOR_PHASES
+  memset(_initialSlots, 0, sizeof(_initialSlots));
+#endif
+
+  if (hasDrainCallbacks) {
+    printMsg(MSG_DRAINING);
+  }
+
+  // Wait for the cleanups, and for the second core to stop its callbacks
+  if (hasDrainCallbacks || !isCoreStopped()) {
+    _drainStartTime = nowMillis();
+    _isDraining = true;
+    return;
+  }
+
+  finishExecution();
+}
+
+/**
+ * This is an internal static method that is called when the setup method is
+ * called again, for example after a simulated reset. Everything that the
+ * last setup left running is stopped, without calling any sketch callbacks,
+ * so the ButtonExecutor starts over as it would after a reset.
+ */
+void resetExecution(void) {
+  stopDispatchTimers();
+  disarmWatches();
+  stopCoreCallbacks();
   for(int index = 0; index < MAX_NUMBER_OF_CALLBACKS; index++) {
-        _timer.stop(_callbackReferences[index]);
-	  _callbackReferences[index] = TIMER_NOT_AN_EVENT;
+    if (_slots[index].reference >= 0) {
+      _timer.stop(_slots[index].reference);
+    }
+  }
+  _timer.stop(_buttonCheckReference);
+  _buttonCheckReference = SCHEDULER_NOT_AN_EVENT;
+#ifdef NOT_AN_INTERRUPT
+  if (_isUsingButtonInterrupt
+      && digitalPinToInterrupt(_buttonPin) != NOT_AN_INTERRUPT) {
+    detachInterrupt(digitalPinToInterrupt(_buttonPin));
+  }
+#endif
+
+  _isDispatching = false;
+  _isStopPending = false;
+  _hasPendingChanges = false;
+  _isCyclic = false;
+  _isFrameTablePending = false;
+#if BUTTON_EXECUTOR_CYCLIC_FRAMES > 0 && BUTTON_EXECUTOR_PHASES
+  memset(_initialSlots, 0, sizeof(_initialSlots));
+#endif
+}
+
+/**
+ * This is an internal static method that stops all registered dispatch
+ * timers, so their callbacks are not called anymore.
+ */
+void stopDispatchTimers(void) {
+#if BUTTON_EXECUTOR_DISPATCH_TIMERS > 0
+  for(int index = 0; index < BUTTON_EXECUTOR_DISPATCH_TIMERS; index++) {
+    if (_dispatchTimers[index]) {
+      _dispatchTimers[index]->stop();
+      _dispatchTimers[index] = NULL;
+    }
+  }
+#endif
+}
+
+/**
+ * This is an internal static method that asks the second core to stop all of
+ * its callbacks. They are not called anymore, even before its next pass.
+ */
+void stopCoreCallbacks(void) {
+#if BUTTON_EXECUTOR_CORE_CALLBACKS > 0
+  for(int entry = 0; entry < BUTTON_EXECUTOR_CORE_CALLBACKS; entry++) {
+    if (_coreRequests[entry] & 1) {
+      _coreRequests[entry]++;
+    }
+  }
+#endif
+}
+
+/**
+ * This is an internal static method that returns true once the second core
+ * has applied all requests of the main core, so none of its callbacks are
+ * running or armed after they were stopped.
+ */
+boolean isCoreStopped(void) {
+#if BUTTON_EXECUTOR_CORE_CALLBACKS > 0
+  for(int entry = 0; entry < BUTTON_EXECUTOR_CORE_CALLBACKS; entry++) {
+    if (_coreRequests[entry] != _coreApplied[entry]) {
+      return false;
+    }
   }
+#endif
+  return true;
+}
 
+/**
+ * This is an internal static method that is called from the loop method while
+ * draining. It calls every drain callback that is not yet done once, and
+ * finishes the execution when they are all done and the second core has
+ * stopped its callbacks, or when the timeout has expired. Without a graceful
+ * stop timeout, the second core is waited for CORE_STOP_TIMEOUT_MS, in case
+ * the loop1 method is not called anymore. The callbacks it has not stopped
+ * by then are reported.
+ */
+void drainExecution(void) {
+  // A callback may still be running on the second core
+  boolean isDrained = isCoreStopped();
+#if BUTTON_EXECUTOR_DRAIN_CALLBACKS
+  for(int index = 0; index < MAX_NUMBER_OF_CALLBACKS; index++) {
+    if (!_slots[index].drainCallback) {
+      continue;
+    }
+
+    if ((*(_slots[index].drainCallback))()) {
+      _slots[index].drainCallback = NULL;
+    } else {
+      isDrained = false;
+    }
+  }
+
+#endif
+
+  if (!isDrained) {
+    unsigned long timeoutMs = _gracefulStopTimeoutMs > 0
+      ? _gracefulStopTimeoutMs : CORE_STOP_TIMEOUT_MS;
+    if (nowMillis() - _drainStartTime < timeoutMs) {
+      return;
+    }
+    printMsg(MSG_DRAINING_TIMED_OUT);
+
+#if BUTTON_EXECUTOR_CORE_CALLBACKS > 0
+    // Only the second core can release its entries, they stay taken until
+    // it applies the stop
+    for(int entry = 0; entry < BUTTON_EXECUTOR_CORE_CALLBACKS; entry++) {
+      if (_coreRequests[entry] != _coreApplied[entry]) {
+        printMsg(MSG_NOT_STOPPED, FIRST_CORE_CALLBACK_ID + entry);
+      }
+    }
+#endif
+  }
+
+  finishExecution();
+}
+
+/**
+ * This is an internal static method that lets the consumers read the samples
+ * left in the registered buffers once no producer is running anymore. A
+ * consumer is called until its buffer is empty, or until a call reads nothing,
+ * then any samples left are discarded. The count of dropped samples is kept
+ * for the sketchStopCallback method.
+ */
+void drainSampleBuffers(void) {
+#if BUTTON_EXECUTOR_SAMPLE_BUFFERS > 0
+  for(uint8_t buffer = 0; buffer < _numberOfSampleBuffers; buffer++) {
+    if (_sampleConsumers[buffer]) {
+      uint16_t available = _sampleBuffers[buffer]->available();
+      while (available > 0) {
+        (*(_sampleConsumers[buffer]))();
+        uint16_t left = _sampleBuffers[buffer]->available();
+        if (left >= available) {
+          break;
+        }
+        available = left;
+      }
+    }
+    _sampleBuffers[buffer]->release(_sampleBuffers[buffer]->available());
+  }
+#endif
+}
+
+/**
+ * This is an internal static method that is used to finish the execution of
+ * the code. It calls the sketchStopCallback method that was registered in the
+ * ButtonExecutor.setup method.
+ */
+void finishExecution(void) {
+#if BUTTON_EXECUTOR_DRAIN_CALLBACKS
+  for(int index = 0; index < MAX_NUMBER_OF_CALLBACKS; index++) {
+    _slots[index].drainCallback = NULL;
+  }
+#endif
+  _isDraining = false;
+  drainSampleBuffers();
+
+  unsigned long startTime = nowMicros();
+  recordLatency(LATENCY_STOP, startTime);
   (*(_sketchStopCallback))();
+  traceEvent(TRACE_STOP, SCHEDULER_NOT_AN_EVENT, startTime);
   _isExecuting = false;
+
+#if BUTTON_EXECUTOR_PROFILE_SIZE > 0
+  if (_isProfiling) {
+    printProfileTable();
+  }
+#endif
   
-	printMsg("*** Ready to start execution");
+	printMsg(MSG_READY);
+}
+
+#if BUTTON_EXECUTOR_CORE_CALLBACKS > 0
+/**
+ * This is an internal static method that is called by the slot dispatchers
+ * of the second core, from its loop1 method. A callback that was stopped by
+ * the main core since the last pass is not called.
+ */
+void dispatchCoreCallback(int entry) {
+  if (_coreRequests[entry] == _coreApplied[entry]) {
+    (*(_coreCallbacks[entry]))();
+  }
+}
+#endif
+
+/**
+ * This is an internal static method that is called by the slot dispatchers
+ * whenever the Timer library calls a registered callback. It calls the
+ * callback and enforces the invocation limit set by
+ * ButtonExecutor.setRunLimits.
+ */
+void dispatchCallback(int index) {
+  // Stopped earlier in this pass
+  if (_isStopPending || isSlotSet(_stopPendingSlots, index)) {
+    return;
+  }
+
+  void (*callback)(void) = _slots[index].callback;
+  unsigned long duration = callCallback(index, callback);
+#if BUTTON_EXECUTOR_PROFILE_SIZE > 0
+  if (_isProfiling && _slots[index].profile != NO_PROFILE
+      && duration > _profiles[_slots[index].profile].maxMicros) {
+    _profiles[_slots[index].profile].maxMicros = duration;
+  }
+#else
+  (void)duration;
+#endif
+
+#if BUTTON_EXECUTOR_PHASES
+  // After the first call of a phased slot, it continues with its period
+  if (isSlotSet(_phaseSlots, index)
+      && _slots[index].phase != _slots[index].period) {
+    _slots[index].phase = _slots[index].period;
+    _hasPendingChanges = true;
+  }
+#endif
+
+  if (callback == _countedCallback && _maxInvocations > 0
+      && ++_invocations >= _maxInvocations) {
+    printMsg(MSG_INVOCATION_LIMIT);
+    stopExecution();
+  }
+}
+
+/**
+ * This is an internal static method that calls a callback of the main core
+ * with the bookkeeping every callback gets: its id is kept in the reset
+ * record while it runs, and its call is traced and counted as busy time.
+ * Returns how long the callback took, in microseconds.
+ */
+unsigned long callCallback(int8_t callbackId, void (*callback)(void)) {
+  _resetRecord.runningCallbackId = callbackId;
+  unsigned long startTime = nowMicros();
+  (*(callback))();
+  unsigned long duration = nowMicros() - startTime;
+  traceEvent(TRACE_DISPATCH, callbackId, startTime);
+  recordBusyTime(duration);
+  _resetRecord.runningCallbackId = SCHEDULER_NOT_AN_EVENT;
+  return duration;
+}
+
+/**
+ * These are internal static methods that test, set and clear the bit of a
+ * slot in one of the slot bitmaps.
+ */
+boolean isSlotSet(const unsigned long* slots, int index) {
+  return (slots[index / SLOT_WORD_BITS] >> (index % SLOT_WORD_BITS)) & 1;
+}
+
+void setSlot(unsigned long* slots, int index) {
+  slots[index / SLOT_WORD_BITS] |= 1UL << (index % SLOT_WORD_BITS);
+}
+
+void clearSlot(unsigned long* slots, int index) {
+  slots[index / SLOT_WORD_BITS] &= ~(1UL << (index % SLOT_WORD_BITS));
+}
+
+/**
+ * This is an internal static method that returns the first free slot, found
+ * with a count trailing zeros instruction on the inverted occupied bitmap,
+ * or -1 if all slots are occupied or reserved by persistent callbacks.
+ */
+int findFreeSlot(void) {
+  for(unsigned int word = 0; word < SLOT_WORDS; word++) {
+    unsigned long freeSlots = ~(_occupiedSlots[word] | _persistentSlots[word]);
+    if (freeSlots) {
+      int index = word * SLOT_WORD_BITS + __builtin_ctzl(freeSlots);
+      return index < MAX_NUMBER_OF_CALLBACKS ? index : -1;
+    }
+  }
+  return -1;
+}
+
+/**
+ * This is an internal static method that registers a callback in a free slot.
+ * The first call is phaseInMs from now, the following ones every periodInMs.
+ * While dispatching, the slot is only reserved and the callback is scheduled
+ * at the end of the pass. Returns false, with the slot freed again, if the
+ * scheduler has no room left for the callback.
+ */
+boolean scheduleCallback(int index, unsigned long periodInMs,
+    unsigned long phaseInMs, void (*callback)(void)) {
+  _slots[index].callback = callback;
+  _slots[index].period = periodInMs;
+#if BUTTON_EXECUTOR_PHASES
+  _slots[index].phase = phaseInMs;
+  if (phaseInMs != periodInMs) {
+    setSlot(_phaseSlots, index);
+  } else {
+    clearSlot(_phaseSlots, index);
+  }
+#else
+  // Without phases, the first call is one period from now
+  phaseInMs = periodInMs;
+#endif
+#if BUTTON_EXECUTOR_SCHEDULABILITY_CHECK
+  _slots[index].wcetInMicros = 0;
+#endif
+#if BUTTON_EXECUTOR_DRAIN_CALLBACKS
+  _slots[index].drainCallback = NULL;
+#endif
+#if BUTTON_EXECUTOR_PROFILE_SIZE > 0
+  _slots[index].profile = _isProfiling ? findProfile(index) : NO_PROFILE;
+#endif
+  setSlot(_occupiedSlots, index);
+
+  // The frame table must include the new callback
+  if (_isCyclicExecutive && _isExecuting) {
+    _isFrameTablePending = true;
+    _hasPendingChanges = true;
+  }
+
+  if (_isDispatching) {
+    _slots[index].reference = PENDING_REFERENCE;
+    _hasPendingChanges = true;
+    return true;
+  }
+  return armSlot(index, phaseInMs);
+}
+
+/**
+ * This is an internal static method that registers the dispatcher of an
+ * occupied slot with the scheduler, first called inMs from now. If the
+ * scheduler is full, the slot is freed and false is returned.
+ */
+boolean armSlot(int index, unsigned long inMs) {
+  _slots[index].reference = _timer.every(inMs,
+    (void (*)(void))pgm_read_ptr(&SLOT_DISPATCHERS.table[index]));
+  if (_slots[index].reference >= 0) {
+    return true;
+  }
+  freeSlot(index);
+  return false;
+}
+
+/**
+ * This is an internal static method that frees a slot whose callback is no
+ * longer scheduled.
+ */
+void freeSlot(int index) {
+  _slots[index].reference = SCHEDULER_NOT_AN_EVENT;
+  clearSlot(_occupiedSlots, index);
+#if BUTTON_EXECUTOR_PHASES
+  clearSlot(_phaseSlots, index);
+#endif
+}
+
+/**
+ * This is an internal static method that returns the time of the first call
+ * of a slot, its phase, or its period when it has none.
+ */
+unsigned long getSlotPhase(int index) {
+#if BUTTON_EXECUTOR_PHASES
+  return _slots[index].phase;
+#else
+  return _slots[index].period;
+#endif
+}
+
+/**
+ * This is an internal static method that is called at the end of every pass
+ * of the scheduler. It applies the changes that were made while dispatching:
+ * first stopping the execution, then stopping and registering callbacks.
+ */
+void applyPendingChanges(void) {
+  if (_isStopPending) {
+    _isStopPending = false;
+    stopExecution();
+  }
+
+  if (!_hasPendingChanges) {
+    return;
+  }
+  _hasPendingChanges = false;
+
+  for(unsigned int word = 0; word < SLOT_WORDS; word++) {
+    unsigned long slots = _occupiedSlots[word];
+    while (slots) {
+      int index = word * SLOT_WORD_BITS + __builtin_ctzl(slots);
+      slots &= slots - 1;
+      if (isSlotSet(_stopPendingSlots, index)) {
+        _timer.stop(_slots[index].reference);
+        freeSlot(index);
+      } else if (_slots[index].reference == PENDING_REFERENCE) {
+        if (!armSlot(index, getSlotPhase(index))) {
+          printMsg(MSG_NOT_SCHEDULED, index);
+        }
+#if BUTTON_EXECUTOR_PHASES
+      } else if (isSlotSet(_phaseSlots, index)
+          && _slots[index].phase == _slots[index].period) {
+        clearSlot(_phaseSlots, index);
+        _timer.stop(_slots[index].reference);
+        if (!armSlot(index, _slots[index].period)) {
+          printMsg(MSG_NOT_SCHEDULED, index);
+        }
+#endif
+      }
+    }
+    _stopPendingSlots[word] = 0;
+  }
+
+  if (_isFrameTablePending) {
+    _isFrameTablePending = false;
+    buildFrameTable();
+  }
+}
+
+/**
+ * This is an internal static method that builds the frame table of the
+ * cyclic executive from the periods and phases of the registered callbacks,
+ * and moves them from the scheduler to the table. If the table does not fit,
+ * the callbacks are moved back to the scheduler.
+ */
+void buildFrameTable(void) {
+#if BUTTON_EXECUTOR_CYCLIC_FRAMES > 0
+  // The minor frame divides every period and phase
+  unsigned long minorFrame = 0;
+  for(int index = 0; index < MAX_NUMBER_OF_CALLBACKS; index++) {
+    if (isSlotSet(_occupiedSlots, index)) {
+      unsigned long period = max((unsigned long)_slots[index].period, 1UL);
+      minorFrame = staticTaskGcd(minorFrame, period);
+      minorFrame = staticTaskGcd(minorFrame, getSlotPhase(index) % period);
+    }
+  }
+
+  // The major frame is a multiple of every period, stop if it gets too long
+  unsigned long majorFrame = minorFrame;
+  boolean isFitting = minorFrame > 0;
+  for(int index = 0; isFitting && index < MAX_NUMBER_OF_CALLBACKS; index++) {
+    if (isSlotSet(_occupiedSlots, index)) {
+      unsigned long period = max((unsigned long)_slots[index].period, 1UL);
+      unsigned long factor = period / staticTaskGcd(majorFrame, period);
+      isFitting = majorFrame / minorFrame
+        <= BUTTON_EXECUTOR_CYCLIC_FRAMES / factor;
+      majorFrame *= factor;
+    }
+  }
+#else
+  boolean isFitting = false;
+#endif
+
+  _isCyclic = isFitting;
+  for(int index = 0; index < MAX_NUMBER_OF_CALLBACKS; index++) {
+    if (!isSlotSet(_occupiedSlots, index)) {
+      continue;
+    }
+    if (isFitting && _slots[index].reference != CYCLIC_REFERENCE) {
+#if BUTTON_EXECUTOR_CYCLIC_FRAMES > 0 && BUTTON_EXECUTOR_PHASES
+      if (isSlotSet(_phaseSlots, index) && _slots[index].phase == 0) {
+        setSlot(_initialSlots, index);
+      }
+#endif
+      _timer.stop(_slots[index].reference);
+      _slots[index].reference = CYCLIC_REFERENCE;
+#if BUTTON_EXECUTOR_PHASES
+      clearSlot(_phaseSlots, index);
+#endif
+    } else if (!isFitting && _slots[index].reference == CYCLIC_REFERENCE) {
+      if (!armSlot(index, _slots[index].period)) {
+        printMsg(MSG_NOT_SCHEDULED, index);
+      }
+    }
+  }
+
+  if (!isFitting) {
+    // Without any callbacks there is no table to build
+    for(unsigned int word = 0; word < SLOT_WORDS; word++) {
+      if (_occupiedSlots[word]) {
+        printMsg(MSG_FRAME_TABLE_TOO_LARGE);
+        break;
+      }
+    }
+    return;
+  }
+
+#if BUTTON_EXECUTOR_CYCLIC_FRAMES > 0
+  // Frame 0 is the end of the major frame, a callback is called in the
+  // frames at its phase plus a multiple of its period
+  _minorFrameMs = minorFrame;
+  _majorFrameMs = majorFrame;
+  _numberOfFrames = majorFrame / minorFrame;
+  memset(_frames, 0, sizeof(_frames));
+  for(int index = 0; index < MAX_NUMBER_OF_CALLBACKS; index++) {
+    if (!isSlotSet(_occupiedSlots, index)) {
+      continue;
+    }
+    unsigned long period = max((unsigned long)_slots[index].period, 1UL);
+    for(unsigned long time = getSlotPhase(index) % period;
+        time < majorFrame; time += period) {
+      setSlot(_frames[time / minorFrame], index);
+    }
+  }
+  _frame = 0;
+  _frameStartTime = nowMillis();
+#endif
+}
+
+/**
+ * This is an internal static method that is called from the loop method by
+ * the cyclic executive. It calls the precomputed callbacks of the minor frame
+ * that is due. When frames were missed, the callbacks of all of them are
+ * called once, like the scheduler calls a late callback once. Callbacks with
+ * a phase of 0 are first called once right away, like the scheduler does.
+ */
+void dispatchFrames(void) {
+#if BUTTON_EXECUTOR_CYCLIC_FRAMES > 0
+#if BUTTON_EXECUTOR_PHASES
+  for(unsigned int word = 0; word < SLOT_WORDS; word++) {
+    unsigned long slots = _initialSlots[word] & _occupiedSlots[word];
+    _initialSlots[word] = 0;
+    while (slots) {
+      int index = word * SLOT_WORD_BITS + __builtin_ctzl(slots);
+      slots &= slots - 1;
+      dispatchCallback(index);
+    }
+  }
+#endif
+
+  unsigned long frames = (nowMillis() - _frameStartTime) / _minorFrameMs;
+  if (frames == 0) {
+    return;
+  }
+  _frameOverruns += frames - 1;
+  _frameStartTime += frames * _minorFrameMs;
+
+  unsigned long dueSlots[SLOT_WORDS];
+  memset(dueSlots, 0, sizeof(dueSlots));
+  for(unsigned long frame = 0; frame < frames && frame < _numberOfFrames;
+      frame++) {
+    _frame = (_frame + 1) % _numberOfFrames;
+    for(unsigned int word = 0; word < SLOT_WORDS; word++) {
+      dueSlots[word] |= _frames[_frame][word];
+    }
+  }
+  _frame = (_frame + frames - min(frames, (unsigned long)_numberOfFrames))
+    % _numberOfFrames;
+
+  for(unsigned int word = 0; word < SLOT_WORDS; word++) {
+    unsigned long slots = dueSlots[word] & _occupiedSlots[word];
+    while (slots) {
+      int index = word * SLOT_WORD_BITS + __builtin_ctzl(slots);
+      slots &= slots - 1;
+      dispatchCallback(index);
+    }
+  }
+#endif
+}
+
+#if BUTTON_EXECUTOR_SCHEDULABILITY_CHECK
+/**
+ * This is an internal static method that checks whether the registered
+ * callbacks with a declared worst case execution time, plus a new one, stay
+ * within the Liu-Layland bound n(2^(1/n) - 1). If not, the utilization is
+ * printed.
+ */
+boolean isSchedulable(unsigned long periodInMs, unsigned long wcetInMicros) {
+  int numberOfTasks = 1;
+  float utilization = (float)wcetInMicros / (max(periodInMs, 1UL) * 1000.0);
+  for(int index = 0; index < MAX_NUMBER_OF_CALLBACKS; index++) {
+    if (!isSlotSet(_occupiedSlots, index)
+        || isSlotSet(_stopPendingSlots, index)
+        || _slots[index].wcetInMicros == 0) {
+      continue;
+    }
+    numberOfTasks++;
+    utilization += (float)_slots[index].wcetInMicros
+      / (max((unsigned long)_slots[index].period, 1UL) * 1000.0);
+  }
+
+  if (utilization <= numberOfTasks * (pow(2.0, 1.0 / numberOfTasks) - 1)) {
+    return true;
+  }
+  printMsg(MSG_NOT_SCHEDULABLE, (long)(utilization * 100 + 0.5));
+  return false;
+}
+#endif
+
+#if BUTTON_EXECUTOR_PROFILE_SIZE > 0
+/**
+ * This is an internal static method that removes all rows from the profile.
+ * While profiling, the callbacks that are still registered, such as
+ * persistent callbacks or those registered before profiling was turned on,
+ * get new rows so they keep being profiled.
+ */
+void clearProfile(void) {
+  _numberOfProfiles = 0;
+  for(int index = 0; index < MAX_NUMBER_OF_CALLBACKS; index++) {
+    _slots[index].profile = _isProfiling && isSlotSet(_occupiedSlots, index)
+      ? findProfile(index) : NO_PROFILE;
+  }
+}
+
+/**
+ * This is an internal static method that returns the row of the profile for
+ * the callback in the given slot, adding a row the first time the callback
+ * is registered with its period. Returns NO_PROFILE if the table is full.
+ */
+uint8_t findProfile(int index) {
+  for(uint8_t profile = 0; profile < _numberOfProfiles; profile++) {
+    if (_profiles[profile].callback == _slots[index].callback
+        && _profiles[profile].periodInMs == _slots[index].period) {
+      _profiles[profile].callbackId = index;
+      return profile;
+    }
+  }
+
+  if (_numberOfProfiles >= BUTTON_EXECUTOR_PROFILE_SIZE) {
+    return NO_PROFILE;
+  }
+  CallbackProfile& profile = _profiles[_numberOfProfiles];
+  profile.callback = _slots[index].callback;
+  profile.periodInMs = _slots[index].period;
+  profile.maxMicros = 0;
+  profile.callbackId = index;
+  return _numberOfProfiles++;
+}
+
+/**
+ * This is an internal static method that prints a row with the period, the
+ * worst case execution time and the utilization of every profiled callback,
+ * followed by the total utilization.
+ */
+void printProfileTable(void) {
+  if (!_printer) {
+    return;
+  }
+
+  _printer->println(
+    F("*** Profile (callback period_ms wcet_us utilization_%)"));
+  float totalUtilization = 0;
+  for(uint8_t profile = 0; profile < _numberOfProfiles; profile++) {
+    float utilization = _profiles[profile].maxMicros
+      / (max((unsigned long)_profiles[profile].periodInMs, 1UL) * 10.0);
+    totalUtilization += utilization;
+    _printer->print(_profiles[profile].callbackId);
+    _printer->print(' ');
+    _printer->print(_profiles[profile].periodInMs);
+    _printer->print(' ');
+    _printer->print(_profiles[profile].maxMicros);
+    _printer->print(' ');
+    _printer->println(utilization);
+  }
+  _printer->print(F("*** Total utilization % "));
+  _printer->println(totalUtilization);
+}
+#endif
+
+/**
+ * This is an internal static method that records an event in the trace ring
+ * buffer, overwriting the oldest event when it is full. A startTime of 0
+ * records an event without a duration.
+ */
+void traceEvent(uint8_t type, int8_t callbackId, unsigned long startTime) {
+#if BUTTON_EXECUTOR_TRACE_SIZE > 0
+  unsigned long now = nowMicros();
+  TraceEvent& event = _trace[_traceHead];
+  event.timestamp = startTime ? startTime : now;
+  event.duration = startTime ? min(now - startTime, 65535UL) : 0;
+  event.type = type;
+  event.callbackId = callbackId;
+  _traceHead = (_traceHead + 1) % BUTTON_EXECUTOR_TRACE_SIZE;
+  if (_traceCount < BUTTON_EXECUTOR_TRACE_SIZE) {
+    _traceCount++;
+  }
+#else
+  (void)type;
+  (void)callbackId;
+  (void)startTime;
+#endif
+}
+
+/**
+ * This is an internal static method that is called on every call to the loop
+ * method when the load monitor is enabled. It counts the calls and, once the
+ * current part of the window is complete, updates the load and loop frequency
+ * over the whole window and starts the next part. It also prints the periodic
+ * report.
+ */
+void updateLoadMonitor(void) {
+#if BUTTON_EXECUTOR_LOAD_SUBWINDOWS > 0
+  _loadLoops[_loadSubwindow]++;
+
+  unsigned long now = nowMicros();
+  unsigned long elapsed = now - _loadSubwindowStartTime;
+  if (elapsed < _loadWindowMs * 1000 / BUTTON_EXECUTOR_LOAD_SUBWINDOWS) {
+    return;
+  }
+  _loadElapsedMicros[_loadSubwindow] = elapsed;
+
+  unsigned long busyMicros = 0;
+  unsigned long elapsedMicros = 0;
+  unsigned long loops = 0;
+  for(int index = 0; index < BUTTON_EXECUTOR_LOAD_SUBWINDOWS; index++) {
+    busyMicros += _loadBusyMicros[index];
+    elapsedMicros += _loadElapsedMicros[index];
+    loops += _loadLoops[index];
+  }
+  _loadPercent = 100.0 * busyMicros / elapsedMicros;
+  _loopFrequency = (unsigned long)(1000000.0 * loops / elapsedMicros);
+
+  // Start the next part of the window, dropping the oldest one
+  _loadSubwindow = (_loadSubwindow + 1) % BUTTON_EXECUTOR_LOAD_SUBWINDOWS;
+  _loadSubwindowStartTime = now;
+  _loadBusyMicros[_loadSubwindow] = 0;
+  _loadElapsedMicros[_loadSubwindow] = 0;
+  _loadLoops[_loadSubwindow] = 0;
+
+  if (_loadReportIntervalMs > 0
+      && nowMillis() - _lastLoadReportTime >= _loadReportIntervalMs) {
+    _lastLoadReportTime = nowMillis();
+    printMsg(MSG_LOAD_PERCENT, (int)(_loadPercent + 0.5));
+    printMsg(MSG_LOOP_FREQUENCY, _loopFrequency);
+  }
+#endif
+}
+
+/**
+ * This is an internal static method that adds the time spent in a callback
+ * to the current part of the window of the load monitor, when enabled.
+ */
+void recordBusyTime(unsigned long duration) {
+#if BUTTON_EXECUTOR_LOAD_SUBWINDOWS > 0
+  if (_loadWindowMs > 0) {
+    _loadBusyMicros[_loadSubwindow] += duration;
+  }
+#else
+  (void)duration;
+#endif
+}
+
+/**
+ * Helper method that returns the current time in milliseconds.
+ */
+unsigned long nowMillis(void) {
+  return (*(_clockMillis))();
+}
+
+/**
+ * Helper method that returns the current time in microseconds.
+ */
+unsigned long nowMicros(void) {
+  return (*(_clockMicros))();
+}
+
+/**
+ * Helper method that reads the button pin, digitalRead is not declared the
+ * same way by every Arduino core.
+ */
+int readButtonPin(uint8_t pin) {
+  return digitalRead(pin);
+}
+
+/**
+ * Helper method that returns where debug messages should be printed, the log
+ * buffer when logging is asynchronous, otherwise the printer (if any).
+ */
+Print* logOutput(void) {
+  if (!_printer) {
+    return NULL;
+  }
+#if BUTTON_EXECUTOR_LOG_BUFFER_SIZE > 0
+  if (_isAsyncLogging) {
+    return &_logBuffer;
+  }
+#endif
+  return _printer;
+}
+
+/**
+ * Helper method that writes buffered debug messages to the printer, but only
+ * as many bytes as it has room for without blocking.
+ */
+void drainLog(void) {
+#if BUTTON_EXECUTOR_LOG_BUFFER_SIZE > 0
+  if (_isAsyncLogging && _printer) {
+    _logBuffer.drainTo(_printer,
+      min(_printer->availableForWrite(), LOG_BYTES_PER_LOOP));
+  }
+#endif
 }
 
 /**
  * Helper method to print debug messages.
  */
-void printMsg(const char msg[]) {
-  if (_printer) {
-    _printer->println(msg);
+void printMsg(uint8_t messageId) {
+  Print* output = logOutput();
+  if (output) {
+    printMsgText(output, messageId);
+    output->println();
+  }
+}
+
+/**
+ * Helper method to print debug messages followed by a value.
+ */
+void printMsg(uint8_t messageId, long value) {
+  Print* output = logOutput();
+  if (output) {
+    printMsgText(output, messageId);
+    if (_isLoggingIds) {
+      output->print(' ');
+    }
+    output->println(value);
+  }
+}
+
+/**
+ * Helper method to print the text of a debug message from flash, or just its
+ * id when message ids are enabled.
+ */
+void printMsgText(Print* output, uint8_t messageId) {
+  if (_isLoggingIds) {
+    output->print('#');
+    output->print(messageId);
+  } else {
+    output->print((const __FlashStringHelper*)
+      pgm_read_ptr(&MESSAGES[messageId]));
   }
 }
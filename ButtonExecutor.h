@@ -15,6 +15,33 @@
  * need to be installed as an Arduino library in your Arduino development
  * environment for this libary to correctly compile.
  *
+ * Alternatively, one of the schedulers included with this library can be used
+ * in place of the Timer library by defining BUTTON_EXECUTOR_SCHEDULER in the
+ * build flags as either BUTTON_EXECUTOR_LINEAR_SCHEDULER or, for many
+ * callbacks, BUTTON_EXECUTOR_TIMING_WHEEL_SCHEDULER. Either is required to run
+ * the ButtonExecutor on a simulated clock (see ButtonExecutorSimulator.h). On
+ * boards that run FreeRTOS, BUTTON_EXECUTOR_FREERTOS_SCHEDULER uses its
+ * software timers. The loop method still polls, unless
+ * FREERTOS_SCHEDULER_MAX_WAIT_MS is set to let it sleep until the next
+ * callback is due (see FreeRTOSScheduler.h).
+ *
+ * Whatever the scheduler, callback ids are kept in an int8_t, so at most 127
+ * callbacks can be registered at the same time. SCHEDULER_MAX_EVENTS must be
+ * 128 or less, one event is used to check the button, and the dispatch
+ * timers, core callbacks, pin callbacks and condition callbacks share the
+ * same 127 ids.
+ *
+ * To fit more callbacks in the memory of small microcontrollers, define
+ * BUTTON_EXECUTOR_SHORT_PERIODS in the build flags to keep periods in 16 bits,
+ * which limits them to 65535 milliseconds. Callbacks with longer periods are
+ * then not installed. This works best with BUTTON_EXECUTOR_LINEAR_SCHEDULER,
+ * which then also keeps its times in 16 bits.
+ *
+ * On dual-core microcontrollers, such as the ESP32 and RP2040, callbacks can
+ * also be run on the second core by defining BUTTON_EXECUTOR_CORE_CALLBACKS in
+ * the build flags and calling the loop1 method from that core (see
+ * callbackEveryByMillisOnCore method).
+ *
  */
 
 #ifndef BUTTON_EXECUTOR_H
@@ -23,10 +50,226 @@
 #include <Arduino.h>
 #include <inttypes.h>
 #include <Print.h>
+#include "DispatchTimer.h"
+#include "SampleBuffer.h"
+
+// Schedulers that can be used to call the registered callbacks
+#define BUTTON_EXECUTOR_TIMER_SCHEDULER (0)
+#define BUTTON_EXECUTOR_LINEAR_SCHEDULER (1)
+#define BUTTON_EXECUTOR_TIMING_WHEEL_SCHEDULER (2)
+#define BUTTON_EXECUTOR_FREERTOS_SCHEDULER (3)
+
+#ifndef BUTTON_EXECUTOR_SCHEDULER
+#define BUTTON_EXECUTOR_SCHEDULER BUTTON_EXECUTOR_TIMER_SCHEDULER
+#endif
+
+#if BUTTON_EXECUTOR_SCHEDULER == BUTTON_EXECUTOR_LINEAR_SCHEDULER
+#include "LinearScheduler.h"
+typedef LinearScheduler ButtonExecutorScheduler;
+#define SCHEDULER_MAX_EVENTS LINEAR_SCHEDULER_MAX_EVENTS
+#define SCHEDULER_NOT_AN_EVENT LINEAR_SCHEDULER_NOT_AN_EVENT
+#define SCHEDULER_HAS_CLOCK
+#elif BUTTON_EXECUTOR_SCHEDULER == BUTTON_EXECUTOR_TIMING_WHEEL_SCHEDULER
+#include "TimingWheelScheduler.h"
+typedef TimingWheelScheduler ButtonExecutorScheduler;
+#define SCHEDULER_MAX_EVENTS TIMING_WHEEL_MAX_EVENTS
+#define SCHEDULER_NOT_AN_EVENT TIMING_WHEEL_NOT_AN_EVENT
+#define SCHEDULER_HAS_CLOCK
+#elif BUTTON_EXECUTOR_SCHEDULER == BUTTON_EXECUTOR_FREERTOS_SCHEDULER
+#include "FreeRTOSScheduler.h"
+#ifndef FREERTOS_SCHEDULER_AVAILABLE
+#error "BUTTON_EXECUTOR_FREERTOS_SCHEDULER requires FreeRTOS with timers"
+#endif
+typedef FreeRTOSScheduler ButtonExecutorScheduler;
+#define SCHEDULER_MAX_EVENTS FREERTOS_SCHEDULER_MAX_EVENTS
+#define SCHEDULER_NOT_AN_EVENT FREERTOS_SCHEDULER_NOT_AN_EVENT
+#else
 #include "Timer.h"
+typedef Timer ButtonExecutorScheduler;
+#define SCHEDULER_MAX_EVENTS MAX_NUMBER_OF_EVENTS
+#define SCHEDULER_NOT_AN_EVENT TIMER_NOT_AN_EVENT
+#endif
+
+#define CALLBACK_STOPPED (1)
+#define CALLBACK_NOT_INSTALLED (SCHEDULER_NOT_AN_EVENT)
+#define CALLBACK_NOT_SCHEDULABLE (-3)
+
+// Policies of the schedulability check done when callbacks are registered
+#define SCHEDULABILITY_CHECK_OFF (0)
+#define SCHEDULABILITY_CHECK_WARN (1)
+#define SCHEDULABILITY_CHECK_REJECT (2)
+
+// Section for variables that must survive a reset of the microcontroller
+#if defined(ESP32)
+#define BUTTON_EXECUTOR_NOINIT __NOINIT_ATTR
+#else
+#define BUTTON_EXECUTOR_NOINIT __attribute__((section(".noinit")))
+#endif
+
+// Number of events kept in the trace, 0 to leave tracing out completely
+#ifndef BUTTON_EXECUTOR_TRACE_SIZE
+#define BUTTON_EXECUTOR_TRACE_SIZE (0)
+#endif
+
+// Size of the buffer used for asynchronous logging, 0 to leave it out
+// completely
+#ifndef BUTTON_EXECUTOR_LOG_BUFFER_SIZE
+#define BUTTON_EXECUTOR_LOG_BUFFER_SIZE (0)
+#endif
+
+// Number of parts of the sliding window of the load monitor, 0 to leave the
+// load monitor out completely
+#ifndef BUTTON_EXECUTOR_LOAD_SUBWINDOWS
+#define BUTTON_EXECUTOR_LOAD_SUBWINDOWS (0)
+#endif
+
+// Number of log2 buckets in the latency histograms, 0 to leave them out
+// completely
+#ifndef BUTTON_EXECUTOR_LATENCY_BUCKETS
+#define BUTTON_EXECUTOR_LATENCY_BUCKETS (0)
+#endif
+
+// Number of rows in the table of profiled callbacks, 0 to leave profiling
+// out completely
+#ifndef BUTTON_EXECUTOR_PROFILE_SIZE
+#define BUTTON_EXECUTOR_PROFILE_SIZE (0)
+#endif
+
+// Set to 1 to keep a drain callback for every callback slot, 0 to leave
+// drain callbacks out completely
+#ifndef BUTTON_EXECUTOR_DRAIN_CALLBACKS
+#define BUTTON_EXECUTOR_DRAIN_CALLBACKS (0)
+#endif
+
+// Set to 1 to keep the worst case execution times of the callbacks for the
+// schedulability check, 0 to leave the check out completely
+#ifndef BUTTON_EXECUTOR_SCHEDULABILITY_CHECK
+#define BUTTON_EXECUTOR_SCHEDULABILITY_CHECK (0)
+#endif
+
+// Set to 1 to keep the phase of every callback slot, so static tasks are
+// first called after their phase, 0 to leave phases out completely
+#ifndef BUTTON_EXECUTOR_PHASES
+#define BUTTON_EXECUTOR_PHASES (0)
+#endif
+
+// Number of minor frames in the frame table of the cyclic executive, 0 to
+// leave the cyclic executive out completely
+#ifndef BUTTON_EXECUTOR_CYCLIC_FRAMES
+#define BUTTON_EXECUTOR_CYCLIC_FRAMES (0)
+#endif
+
+// Number of hardware timers that can dispatch callbacks at the same time, 0
+// to leave the dispatch timers out completely
+#ifndef BUTTON_EXECUTOR_DISPATCH_TIMERS
+#define BUTTON_EXECUTOR_DISPATCH_TIMERS (0)
+#endif
+
+// Number of callbacks that can run on the second core of dual-core
+// microcontrollers, 0 to leave the second core out completely
+#ifndef BUTTON_EXECUTOR_CORE_CALLBACKS
+#define BUTTON_EXECUTOR_CORE_CALLBACKS (0)
+#endif
+
+// Number of sample buffers that can be registered, 0 to leave them out
+// completely
+#ifndef BUTTON_EXECUTOR_SAMPLE_BUFFERS
+#define BUTTON_EXECUTOR_SAMPLE_BUFFERS (0)
+#endif
+
+// Number of pin edge callbacks that can be declared, 0 to leave them out
+// completely
+#ifndef BUTTON_EXECUTOR_WATCHES
+#define BUTTON_EXECUTOR_WATCHES (0)
+#endif
+
+// Number of condition callbacks that can be declared, 0 to leave them out
+// completely
+#ifndef BUTTON_EXECUTOR_CONDITIONS
+#define BUTTON_EXECUTOR_CONDITIONS (0)
+#endif
+
+// Cores that callbacks can be run on
+#define MAIN_CORE (0)
+#define SECOND_CORE (1)
+
+// Latency histograms
+#define LATENCY_START (0)
+#define LATENCY_STOP (1)
 
-#define CALLBACK_STOPPED (1);
-#define CALLBACK_NOT_INSTALLED (TIMER_NOT_AN_EVENT);
+// Types of the events recorded in the trace
+#define TRACE_DISPATCH (0)
+#define TRACE_START (1)
+#define TRACE_STOP (2)
+#define TRACE_BUTTON_PRESS (3)
+#define TRACE_BUTTON_RELEASE (4)
+
+/**
+ * A single event recorded in the trace. The timestamp is in microseconds, the
+ * duration is the time in microseconds spent in the callback (saturated at
+ * 65535) for dispatch, start and stop events.
+ */
+struct TraceEvent {
+  uint32_t timestamp;
+  uint16_t duration;
+  uint8_t type;
+  int8_t callbackId;
+};
+
+/**
+ * A callback of a task table that is fixed at compile time (see
+ * ButtonExecutor.setStaticTasks method). The callback is first called
+ * phaseInMs after execution is started, then every periodInMs. Phases are
+ * only kept when BUTTON_EXECUTOR_PHASES is set to 1 in the build flags,
+ * otherwise the callback is first called periodInMs after the start.
+ */
+struct StaticTask {
+  unsigned long periodInMs;
+  unsigned long phaseInMs;
+  void (*callback)(void);
+};
+
+/**
+ * Returns true if every task of the table has a period, a phase shorter than
+ * its period and a callback, and the tasks are ordered by period, shortest
+ * first. Tasks that are due at the same time are called in the order of the
+ * table, so the shortest periods go first as in rate-monotonic scheduling.
+ * Meant to be checked at compile time with static_assert.
+ *
+ * tasks - Constexpr table of tasks.
+ * numberOfTasks - Number of tasks in the table.
+ */
+constexpr boolean isValidStaticTaskTable(const StaticTask* tasks,
+    uint8_t numberOfTasks) {
+  return numberOfTasks == 0
+    || (tasks[0].periodInMs > 0 && tasks[0].phaseInMs < tasks[0].periodInMs
+      && tasks[0].callback != NULL
+      && (numberOfTasks == 1 || tasks[0].periodInMs <= tasks[1].periodInMs)
+      && isValidStaticTaskTable(tasks + 1, numberOfTasks - 1));
+}
+
+/**
+ * Returns the greatest common divisor of two periods.
+ */
+constexpr unsigned long staticTaskGcd(unsigned long a, unsigned long b) {
+  return b == 0 ? a : staticTaskGcd(b, a % b);
+}
+
+/**
+ * Returns the hyperperiod of the table, the least common multiple of all of
+ * the periods, after which the pattern of calls repeats. Can be computed at
+ * compile time.
+ *
+ * tasks - Constexpr table of tasks.
+ * numberOfTasks - Number of tasks in the table.
+ * hyperperiod - Hyperperiod of the tasks before the table, 1 by default.
+ */
+constexpr unsigned long staticTaskHyperperiod(const StaticTask* tasks,
+    uint8_t numberOfTasks, unsigned long hyperperiod = 1) {
+  return numberOfTasks == 0 ? hyperperiod
+    : staticTaskHyperperiod(tasks + 1, numberOfTasks - 1, hyperperiod
+      / staticTaskGcd(hyperperiod, tasks[0].periodInMs) * tasks[0].periodInMs);
+}
 
 class ButtonExecutor {
 
@@ -56,6 +299,12 @@ public:
    *
    * When completed, the button can be pushed again, and the cycle will repeat.
    *
+   * Calling this method again starts over as after a reset of the
+   * microcontroller: everything is stopped without calling the
+   * sketchStopCallback method, and all callbacks must be registered and
+   * declared again. This is meant to simulate a reset, such as one by the
+   * watchdog (see setWatchdog method).
+   *
    * buttonPin - Pin number to monitor for push button activity.
    * sketchSetupCallback - Callback method that is executed only once to setup
    *   the code for execution.
@@ -76,6 +325,17 @@ public:
    */
   void loop();
 
+  /**
+   * Call this method repeatedly from the second core of a dual-core
+   * microcontroller to run the callbacks registered for it (see
+   * callbackEveryByMillisOnCore method). On the RP2040 this would be called
+   * from the Arduino loop1 method, on the ESP32 from a task pinned to the
+   * core that does not run the Arduino loop method. The second core has its
+   * own scheduler, so its callbacks are never delayed by those of the main
+   * core. Does nothing unless BUTTON_EXECUTOR_CORE_CALLBACKS is defined.
+   */
+  void loop1();
+
   /**
    * Call this method to register callbacks that should be executed after the
    * button is pushed. Normally called from the sketchStartCallback method
@@ -91,16 +351,39 @@ public:
    * pushed to stop execution. Callback registration is not maintained between
    * starts and stops of execution.
    *
+   * It is safe to call this method from inside a callback. A callback
+   * registered while callbacks are being dispatched is scheduled at the end
+   * of the current pass of the loop method, its period starts then.
+   *
    * periodInMs - Period of time, in milliseconds, to execute the callback.
    * callback - Callback method that should be executed.
    * Returns a reference to the registered callback that can be used in a
    * subsequent call to ButtonExecutor.stopCallback to stop the execution of the
    * callback before the button is pushed to stop execution. Can also return
    * CALLBACK_NOT_INSTALLED if the callback could not be installed due to the
-   * maximum number of callbacks already registered.
+   * maximum number of callbacks already registered, or a period that is too
+   * long for BUTTON_EXECUTOR_SHORT_PERIODS.
    */
   int8_t callbackEveryByMillis(unsigned long periodInMs,
     void (*callback)(void));
+
+  /**
+   * Same as the callbackEveryByMillis method above, but also declares the
+   * worst case execution time of the callback. Callbacks with a declared
+   * execution time are checked against the rate-monotonic utilization bound
+   * when registered (see setSchedulabilityCheck method).
+   *
+   * periodInMs - Period of time, in milliseconds, to execute the callback.
+   * callback - Callback method that should be executed.
+   * wcetInMicros - Worst case execution time of the callback, in
+   *   microseconds. A value of 0 means unknown, the callback is then left out
+   *   of the check.
+   * Returns a reference to the registered callback, CALLBACK_NOT_INSTALLED if
+   *   the maximum number of callbacks are already registered, or
+   *   CALLBACK_NOT_SCHEDULABLE if the callback was rejected by the check.
+   */
+  int8_t callbackEveryByMillis(unsigned long periodInMs,
+    void (*callback)(void), unsigned long wcetInMicros);
   
   /**
    * Call this method to register callbacks that should be executed after the
@@ -129,9 +412,225 @@ public:
    *   to the maximum number of callbacks already registered.
    */
   int8_t callbackEveryByHertz(unsigned long periodinHz, void (*callback)(void));
+
+  /**
+   * Same as the callbackEveryByHertz method above, but also declares the
+   * worst case execution time of the callback (see callbackEveryByMillis).
+   *
+   * periodinHz - Period in hertz, number of times per second to execute the
+   *   callback.
+   * callback - Callback method that should be executed.
+   * wcetInMicros - Worst case execution time of the callback, in
+   *   microseconds, 0 if unknown.
+   * Returns a reference to the registered callback, CALLBACK_NOT_INSTALLED or
+   *   CALLBACK_NOT_SCHEDULABLE.
+   */
+  int8_t callbackEveryByHertz(unsigned long periodinHz, void (*callback)(void),
+    unsigned long wcetInMicros);
+
+  /**
+   * Call this method to register a callback that must be called at a rate the
+   * loop method can not keep, or with less jitter than it allows, such as
+   * generating the step pulses of a stepper motor. The callback is called
+   * from the interrupt of a hardware timer (see AvrTimer1DispatchTimer.h), no
+   * matter what the loop method is doing.
+   *
+   * Because it runs in an interrupt, the callback must be short, must only
+   * share volatile variables with the rest of the sketch, and must not call
+   * any ButtonExecutor method. It is not traced, profiled or counted by the
+   * load monitor or run limits. The timer is stopped as soon as the button is
+   * pushed to stop execution, even when other callbacks are still draining,
+   * and must be registered again after the next start.
+   *
+   * timer - The hardware timer that calls the callback. Registering the same
+   *   timer again replaces its callback, or stops the timer if it can not
+   *   generate the new period.
+   * periodInMicros - Period of time, in microseconds, to call the callback.
+   * callback - Callback method that should be called.
+   * Returns a reference to the registered callback that can be used in a
+   *   subsequent call to ButtonExecutor.stopCallback. Can also return
+   *   CALLBACK_NOT_INSTALLED if BUTTON_EXECUTOR_DISPATCH_TIMERS timers are
+   *   already registered, or is 0, or the timer can not generate the period.
+   */
+  int8_t callbackEveryByMicros(DispatchTimer* timer,
+    unsigned long periodInMicros, void (*callback)(void));
+
+  /**
+   * Same as the callbackEveryByMillis method, but also selects the core that
+   * calls the callback. Callbacks for the SECOND_CORE are registered from
+   * the main core, like any other callback, and are armed by the next call to
+   * the loop1 method. Their period starts then.
+   *
+   * Starting and stopping is still done by the button on the main core. When
+   * execution is stopped, the callbacks of the second core are not called
+   * anymore, and the sketchStopCallback method is only called after a
+   * callback that was already running on the second core has returned. A
+   * callback stopped with stopCallback can be called once more if it was
+   * already running. The main core waits for the second core no longer than
+   * the graceful stop timeout (see setGracefulStopTimeout method), or 1
+   * second if none is set, so it still stops if the loop1 method is not
+   * called anymore. A message is then printed with the reference of every
+   * callback the second core has not stopped, which may still be running
+   * when the sketchStopCallback method is called. Its entry can not be
+   * registered again until the loop1 method has stopped it.
+   *
+   * Callbacks on the second core must only share volatile variables with the
+   * rest of the sketch and must not call any ButtonExecutor method. They are
+   * not traced, profiled or counted by the load monitor or run limits.
+   *
+   * periodInMs - Period of time, in milliseconds, to execute the callback.
+   * callback - Callback method that should be executed.
+   * core - Either MAIN_CORE or SECOND_CORE.
+   * Returns a reference to the registered callback, or CALLBACK_NOT_INSTALLED
+   *   if the maximum number of callbacks of the core are already registered.
+   */
+  int8_t callbackEveryByMillisOnCore(unsigned long periodInMs,
+    void (*callback)(void), uint8_t core);
+
+  /**
+   * Same as the callbackEveryByMillisOnCore method, except period is given in
+   * hertz by the periodInHz parameter.
+   *
+   * periodinHz - Period in hertz, number of times per second to execute the
+   *   callback.
+   * callback - Callback method that should be executed.
+   * core - Either MAIN_CORE or SECOND_CORE.
+   * Returns a reference to the registered callback, or CALLBACK_NOT_INSTALLED.
+   */
+  int8_t callbackEveryByHertzOnCore(unsigned long periodInHz,
+    void (*callback)(void), uint8_t core);
   
+  /**
+   * Call this method to declare a callback that should be executed every time
+   * the button is pushed to start execution. Normally called from the
+   * sketchSetupCallback method registered in the ButtonExecutor.setup method.
+   *
+   * Unlike callbackEveryByMillis, the callback only needs to be declared once.
+   * It is armed automatically, before the sketchStartCallback method is
+   * called, every time execution is started and it is stopped along with all
+   * other callbacks when execution is stopped.
+   *
+   * The persistent callback keeps a slot of its own, so its reference is the
+   * same on every run and is never given to another callback. While
+   * executing, it can be used like a reference returned by
+   * callbackEveryByMillis, for example to stop the callback with
+   * stopCallback until the next start. A drain callback can be registered
+   * for it with setDrainCallback, but only for the current run, so normally
+   * from the sketchStartCallback method.
+   *
+   * periodInMs - Period of time, in milliseconds, to execute the callback.
+   * callback - Callback method that should be executed.
+   * Returns a reference to the persistent callback, or CALLBACK_NOT_INSTALLED
+   *   if the maximum number of callbacks are already registered or declared.
+   */
+  int8_t persistentCallbackEveryByMillis(unsigned long periodInMs,
+    void (*callback)(void));
+
+  /**
+   * Same as the persistentCallbackEveryByMillis method, except period is given
+   * in hertz by the periodInHz parameter.
+   *
+   * periodinHz - Period in hertz, number of times per second to execute the
+   *   callback.
+   * callback - Callback method that should be executed.
+   * Returns a reference to the persistent callback, or CALLBACK_NOT_INSTALLED
+   *   if the maximum number of callbacks are already registered or declared.
+   */
+  int8_t persistentCallbackEveryByHertz(unsigned long periodInHz,
+    void (*callback)(void));
+
+  /**
+   * Call this method to declare a callback that should be executed when an
+   * input pin changes, such as a limit switch, instead of polling the pin
+   * from a periodic callback. Normally called from the sketchSetupCallback
+   * method, after the pinMode of the pin is set.
+   *
+   * Like persistentCallbackEveryByMillis, the callback only needs to be
+   * declared once. The pin is armed every time execution is started, after
+   * the sketchStartCallback method returns, and disarmed as soon as the
+   * button is pushed to stop execution, so the callback is only called while
+   * executing.
+   *
+   * All armed pins are read in one batch on every call to the loop method,
+   * directly from the input registers of their ports where the board
+   * supports it, and the callback is called when an edge is seen. A pulse
+   * shorter than a pass of the loop method can be missed, unless pin
+   * interrupts are used (see usePinInterrupts method). Either way the
+   * callback is called from the loop method, at most once per pass. The pin
+   * is not debounced.
+   *
+   * Like the scheduled callbacks, the callback is traced, counted by the load
+   * monitor and named by getResetCallbackId if the watchdog resets the
+   * microcontroller while it runs. It has no period, so it is not profiled
+   * (see setProfiling method). Its reference follows the references of the
+   * other callbacks, so it cannot be mistaken for one of them, but it cannot
+   * be stopped with stopCallback.
+   *
+   * Pin callbacks are only available when BUTTON_EXECUTOR_WATCHES is defined
+   * to be larger than 0 in the build flags.
+   *
+   * pin - Pin number to watch.
+   * edge - RISING, FALLING or CHANGE, as for attachInterrupt.
+   * callback - Callback method that should be executed.
+   * Returns a reference to the pin callback, or CALLBACK_NOT_INSTALLED if
+   *   BUTTON_EXECUTOR_WATCHES pin callbacks have already been declared.
+   */
+  int8_t callbackOnPinEdge(uint8_t pin, uint8_t edge, void (*callback)(void));
+
+  /**
+   * Call this method to declare a callback that should be executed when a
+   * condition becomes true, such as a temperature crossing a threshold,
+   * instead of writing a periodic callback that polls it. Normally called
+   * from the sketchSetupCallback method.
+   *
+   * The condition is armed, disarmed and called like the pins of
+   * callbackOnPinEdge. Every periodInMs while executing, the predicate is
+   * evaluated, together with the other conditions in one batch, and the
+   * callback is called when it returns true after it last returned false. A
+   * condition that is already true when execution is started has to become
+   * false first.
+   *
+   * Condition callbacks are only available when BUTTON_EXECUTOR_CONDITIONS
+   * is defined to be larger than 0 in the build flags.
+   *
+   * predicate - Method that returns the condition, it should be quick and
+   *   have no side effects.
+   * periodInMs - Period of time, in milliseconds, to evaluate the predicate,
+   *   0 for every call to the loop method.
+   * callback - Callback method that should be executed.
+   * Returns a reference to the condition callback, or CALLBACK_NOT_INSTALLED
+   *   if BUTTON_EXECUTOR_CONDITIONS condition callbacks have already been
+   *   declared.
+   */
+  int8_t callbackWhen(boolean (*predicate)(void), unsigned long periodInMs,
+    void (*callback)(void));
+
+  /**
+   * Same as callbackWhen, but the callback is executed at most once per
+   * execution, the first time the condition becomes true.
+   */
+  int8_t callbackOnceWhen(boolean (*predicate)(void), unsigned long periodInMs,
+    void (*callback)(void));
+
+  /**
+   * Call this method before execution is started to have the edges of the
+   * pins of callbackOnPinEdge latched by an interrupt, on the pins that
+   * support interrupts, so even short pulses are not missed. The callbacks
+   * are still called from the loop method.
+   *
+   * isUsingInterrupts - True to attach interrupts to the watched pins.
+   */
+  void usePinInterrupts(boolean isUsingInterrupts);
+
   /**
    * Call this method to stop the execution of a previously registered callback.
+   *
+   * It is safe to call this method from inside a callback, including the
+   * callback being stopped. The callback is not called again, even later in
+   * the same pass of the loop method, but its reference is only released at
+   * the end of the pass, so it is not reused by callbacks registered in the
+   * same pass. A callback registered with callbackEveryByMicros is stopped
+   * right away.
    * 
    * callbackId - A reference to the callback returned by the
    * ButtonExecutor.callbackEvery method.
@@ -140,10 +639,423 @@ public:
    * callbacks.
    */
   int8_t stopCallback(int8_t callbackId);
+
+  /**
+   * Call this method to run the callbacks as a cyclic executive. When
+   * execution is started, after the sketchStartCallback method returns, the
+   * minor frame is computed as the greatest common divisor of the periods
+   * and phases of all registered callbacks, and the major frame as the least
+   * common multiple of the periods. A table with the callbacks to call in
+   * every minor frame of the major frame is then built once, and every minor
+   * frame just calls its precomputed list of callbacks, in the order of
+   * their callback ids. No scheduling decisions are made while executing.
+   *
+   * The first frame is one minor frame after the start. A callback is called
+   * in the frames at its phase plus a multiple of its period, which is the
+   * end of every period for callbacks that do not have a phase. A callback
+   * with a phase of 0 is also called once right away, before the first
+   * frame, just as the scheduler calls it at the start. When the loop method
+   * is called too late and minor frames are missed, they are counted as
+   * overruns (see getFrameOverruns method) and the callbacks of the missed
+   * frames are called once, in the frame that catches up.
+   *
+   * The cyclic executive is only available when BUTTON_EXECUTOR_CYCLIC_FRAMES
+   * is defined to be larger than 0, as the maximum number of minor frames in
+   * the major frame. If the table does not fit, a message is printed and the
+   * callbacks are scheduled as usual. Callbacks registered while executing
+   * rebuild the table, which restarts the major frame.
+   *
+   * isCyclic - True to run the callbacks as a cyclic executive from the next
+   *   start of execution, false to schedule them as usual.
+   */
+  void setCyclicExecutive(boolean isCyclic);
+
+  /**
+   * Returns the length of the minor frame, in milliseconds, of the cyclic
+   * executive, or 0 if the callbacks are not run by the cyclic executive.
+   */
+  unsigned long getMinorFrame();
+
+  /**
+   * Returns the length of the major frame, in milliseconds, of the cyclic
+   * executive, or 0 if the callbacks are not run by the cyclic executive.
+   */
+  unsigned long getMajorFrame();
+
+  /**
+   * Returns the number of minor frames of the cyclic executive that were
+   * missed since execution was started.
+   */
+  unsigned long getFrameOverruns();
+
+  /**
+   * Call this method to print the frame table of the cyclic executive, the
+   * callback ids called in every minor frame, to the Print output.
+   */
+  void printFrameTable();
+
+  /**
+   * Call this method to set a table of tasks that is fixed at compile time,
+   * normally from the sketchSetupCallback method. Like the persistent
+   * callbacks, the tasks are armed automatically every time execution is
+   * started, before any other callback and in the order of the table, so
+   * their callback ids are known in advance when no other callbacks are
+   * registered before the start. They take the first slots that are not
+   * reserved by persistent callbacks. The table is read from flash and
+   * nothing is copied, so it does not take any memory. A task that can not
+   * be armed, because no slot is left or its period is too long, is skipped
+   * and reported to the Print output.
+   *
+   * The table should be declared constexpr and PROGMEM, and checked at
+   * compile time, for example:
+   *
+   *   constexpr StaticTask TASKS[] PROGMEM = {
+   *     { 10, 0, readSensors }, { 20, 5, updateMotors } };
+   *   static_assert(isValidStaticTaskTable(TASKS, 2), "Invalid task table");
+   *   static_assert(staticTaskHyperperiod(TASKS, 2) == 20, "Wrong period");
+   *
+   * tasks - Table of tasks, in flash.
+   * numberOfTasks - Number of tasks in the table, 0 to clear the table.
+   */
+  void setStaticTasks(const StaticTask* tasks, uint8_t numberOfTasks);
   
+  /**
+   * Call this method to register a drain callback for a previously registered
+   * callback. The drain callback is only used when a graceful stop timeout has
+   * been set (see setGracefulStopTimeout method).
+   *
+   * When execution is stopped, the registered callbacks are stopped and then
+   * every drain callback is called once per call to the loop method until it
+   * returns true to indicate that it is done, or until the graceful stop
+   * timeout expires. Only then is the sketchStopCallback method called. This
+   * allows hardware to be brought to a safe state without blocking.
+   *
+   * Drain callbacks are only available when BUTTON_EXECUTOR_DRAIN_CALLBACKS
+   * is defined to be 1 in the build flags. Otherwise this method always
+   * returns CALLBACK_NOT_INSTALLED.
+   *
+   * callbackId - A reference to the callback returned by the
+   *   ButtonExecutor.callbackEvery method.
+   * drainCallback - Callback method that performs one step of the cleanup and
+   *   returns true when the cleanup is complete.
+   * Returns the callbackId if the drain callback was registered or
+   *   CALLBACK_NOT_INSTALLED if the callbackId does not match any registered
+   *   callbacks.
+   */
+  int8_t setDrainCallback(int8_t callbackId, boolean (*drainCallback)(void));
+
+  /**
+   * Call this method to register a SampleBuffer (see SampleBuffer.h) that
+   * passes samples from a producer callback to a consumer callback. Normally
+   * called from the sketchSetupCallback method, the registration is kept
+   * between starts and stops of execution.
+   *
+   * Every time execution is started, the buffer is cleared before the
+   * sketchStartCallback method is called, so no samples of the last run are
+   * left. When execution is stopped, once all callbacks have stopped, the
+   * consumer is called until it has read all of the samples left in the
+   * buffer, and only then is the sketchStopCallback method called. The count
+   * of dropped samples is kept until the next start.
+   *
+   * buffer - The buffer to register.
+   * consumer - Callback method that reads samples from the buffer, normally
+   *   the same method that is registered to consume them periodically, or
+   *   NULL to discard the samples left when execution is stopped.
+   * Returns true if the buffer was registered, or false if
+   *   BUTTON_EXECUTOR_SAMPLE_BUFFERS buffers are already registered, or is 0.
+   */
+  boolean registerSampleBuffer(SampleBufferBase* buffer,
+    void (*consumer)(void));
+
+  /**
+   * Call this method to set the maximum time to wait for the drain callbacks
+   * to complete when execution is stopped. A value of 0, the default, stops
+   * execution immediately without calling any of the drain callbacks. The
+   * same timeout limits the wait for the callbacks of the second core to
+   * stop (see callbackEveryByMillisOnCore method).
+   *
+   * timeoutInMs - Maximum time, in milliseconds, to keep calling the drain
+   *   callbacks before the sketchStopCallback method is called.
+   */
+  void setGracefulStopTimeout(unsigned long timeoutInMs);
+
+  /**
+   * Call this method to automatically stop execution after it has run for a
+   * given amount of time. The limit is checked on every call to the loop
+   * method, before any callbacks are called, so no callback is called after
+   * the limit has been reached. This is the code equivalent of pushing the
+   * button to stop execution at exactly the right time.
+   *
+   * maxDurationInMs - Maximum time, in milliseconds, to execute after the
+   *   button is pushed to start execution. A value of 0, the default, means
+   *   there is no limit.
+   */
+  void setRunLimits(unsigned long maxDurationInMs);
+
+  /**
+   * Same as the setRunLimits method above, but execution is also stopped
+   * right after the given callback has been called a number of times.
+   *
+   * maxDurationInMs - Maximum time, in milliseconds, to execute. A value of 0
+   *   means there is no limit.
+   * countedCallback - Callback method, registered with one of the
+   *   callbackEvery methods, whose calls are counted.
+   * maxInvocations - Number of calls of the countedCallback after which the
+   *   execution is stopped. A value of 0 means there is no limit.
+   */
+  void setRunLimits(unsigned long maxDurationInMs,
+    void (*countedCallback)(void), unsigned long maxInvocations);
+
+  /**
+   * Call this method to check every callback registered with a worst case
+   * execution time against the rate-monotonic utilization bound of Liu and
+   * Layland. The n callbacks with a declared execution time are guaranteed to
+   * meet their deadlines, if the shortest periods are given priority, as
+   * long as the sum of their execution time divided by their period stays
+   * under n(2^(1/n) - 1), from 100% for one callback down to about 69% for
+   * many. A task set above the bound may still be schedulable, but it is no
+   * longer guaranteed. The ButtonExecutor does not preempt callbacks, so the
+   * check is meant to catch configurations that are clearly overloaded.
+   *
+   * The check is only available when BUTTON_EXECUTOR_SCHEDULABILITY_CHECK is
+   * defined to be 1 in the build flags. Otherwise the worst case execution
+   * times are not kept, and every callback is registered unchecked.
+   *
+   * policy - SCHEDULABILITY_CHECK_OFF, the default, to not check.
+   *   SCHEDULABILITY_CHECK_WARN to print a message with the utilization but
+   *   still register the callback. SCHEDULABILITY_CHECK_REJECT to print the
+   *   message and not register the callback.
+   */
+  void setSchedulabilityCheck(uint8_t policy);
+
+  /**
+   * Call this method before the setup method to replace the clock used by the
+   * ButtonExecutor, millis and micros by default. This is meant to run the
+   * ButtonExecutor on a simulated clock (see ButtonExecutorSimulator.h), which
+   * requires the linear or timing wheel scheduler since the Timer library
+   * always uses millis, and FreeRTOS its ticks.
+   *
+   * clockMillis - Method that returns the current time in milliseconds.
+   * clockMicros - Method that returns the current time in microseconds.
+   */
+  void setClock(unsigned long (*clockMillis)(void),
+    unsigned long (*clockMicros)(void));
+
+  /**
+   * Call this method before the setup method to replace how the button pin is
+   * read, digitalRead by default. This is meant to simulate button pushes.
+   *
+   * readPin - Method that returns the state of the given pin.
+   */
+  void setPinReader(int (*readPin)(uint8_t pin));
+
+  /**
+   * Call this method to let the ButtonExecutor feed a watchdog. The
+   * feedWatchdog method is called at the end of every call to the loop method,
+   * but only if that call completed within maxPassInMicros. If a callback
+   * blocks or keeps overrunning, the watchdog is no longer fed and will reset
+   * the microcontroller. Enabling the hardware watchdog is left to the sketch,
+   * for example by calling wdt_enable in the sketchSetupCallback on AVR.
+   *
+   * The id of the callback that was running when the reset occurred is kept
+   * in memory that is not initialized on reset, and is reported by the setup
+   * method after the reset (see getResetCallbackId method).
+   *
+   * feedWatchdog - Method that feeds the watchdog, for example a method that
+   *   calls wdt_reset on AVR. Can also be a simulated watchdog for testing.
+   * maxPassInMicros - Maximum time, in microseconds, that a call to the loop
+   *   method may take for the watchdog to be fed.
+   */
+  void setWatchdog(void (*feedWatchdog)(void), unsigned long maxPassInMicros);
+
+  /**
+   * Returns the id of the callback that was running when the microcontroller
+   * was last reset, as found by the setup method, or CALLBACK_NOT_INSTALLED if
+   * no callback was running.
+   */
+  int8_t getResetCallbackId();
+
+  /**
+   * Call this method before the setup method to timestamp button edges with
+   * an interrupt on the button pin, if the pin supports interrupts. This makes
+   * the latency histograms (see getLatencyCount method) exact. Otherwise the
+   * press is timestamped when the button is checked, every 10 milliseconds.
+   * The button is still debounced the same way in both cases.
+   *
+   * isUsingInterrupt - True to attach an interrupt to the button pin.
+   */
+  void useButtonInterrupt(boolean isUsingInterrupt);
+
+  /**
+   * Returns the number of button pushes in one bucket of a latency histogram.
+   * The latency is the time from the button being pushed until the
+   * sketchStartCallback (LATENCY_START) or sketchStopCallback (LATENCY_STOP)
+   * method is called. Bucket 0 counts latencies under 2 microseconds, every
+   * other bucket n counts latencies from 2^n up to 2^(n+1) microseconds. The
+   * last bucket also counts all longer latencies.
+   *
+   * The histograms are only kept when BUTTON_EXECUTOR_LATENCY_BUCKETS is
+   * defined to be larger than 0, 24 buckets cover latencies up to about 16
+   * seconds. Otherwise this method always returns 0.
+   *
+   * latencyType - Either LATENCY_START or LATENCY_STOP.
+   * bucket - Bucket of the histogram, less than
+   *   BUTTON_EXECUTOR_LATENCY_BUCKETS.
+   */
+  uint16_t getLatencyCount(uint8_t latencyType, uint8_t bucket);
+
+  /**
+   * Call this method to print the non-empty buckets of both latency
+   * histograms to the Print output given to the constructor.
+   */
+  void printLatencyHistogram();
+
+  /**
+   * Call this method to clear both latency histograms.
+   */
+  void clearLatencyHistogram();
+
+  /**
+   * Call this method to profile the registered callbacks. While profiling,
+   * the maximum observed execution time of every callback is recorded, and
+   * when execution is stopped a table is printed to the Print output with
+   * the period, the worst case execution time (WCET) and the utilization of
+   * every callback, followed by the total utilization. Pushing the button to
+   * start and stop a test run then gives a capacity report of the sketch, and
+   * the measured times can be declared to callbackEveryByMillis.
+   *
+   * The table is cleared when profiling is turned on and when execution is
+   * started, callbacks that are already registered then, such as persistent
+   * callbacks, keep being profiled. A callback registered more than once
+   * with the same period during a run has a single row in the table. Pin
+   * and condition callbacks are not profiled. The table has
+   * BUTTON_EXECUTOR_PROFILE_SIZE rows, callbacks beyond them are not
+   * profiled. Profiling is only available when it is defined to be larger
+   * than 0 in the build flags.
+   *
+   * isProfiling - True to record the execution times, false to stop.
+   */
+  void setProfiling(boolean isProfiling);
+
+  /**
+   * Call this method to print the table of the profiled callbacks of the
+   * current or last run (see setProfiling method) to the Print output.
+   */
+  void printProfile();
+
+  /**
+   * Call this method to monitor how busy the microcontroller is. The load is
+   * the percentage of time spent in the registered callbacks, the rest of the
+   * time is available for other work. The loop frequency is the number of
+   * calls to the loop method per second. Both are measured over a sliding
+   * window and can be printed periodically to the Print output.
+   *
+   * The load monitor is only available when BUTTON_EXECUTOR_LOAD_SUBWINDOWS
+   * is defined to be larger than 0, as the number of parts of the window,
+   * 4 for example. The oldest part is dropped from the window every time a
+   * new one is complete.
+   *
+   * windowInMs - Length of the sliding window, in milliseconds. A value of 0
+   *   disables the load monitor.
+   * reportIntervalInMs - Period of time, in milliseconds, between reports
+   *   printed to the Print output. A value of 0 disables the reports.
+   */
+  void enableLoadMonitor(unsigned long windowInMs,
+    unsigned long reportIntervalInMs);
+
+  /**
+   * Returns the percentage of time spent in the registered callbacks over the
+   * window of the load monitor (see enableLoadMonitor method).
+   */
+  float getLoadPercent();
+
+  /**
+   * Returns the number of calls to the loop method per second over the window
+   * of the load monitor (see enableLoadMonitor method).
+   */
+  unsigned long getLoopFrequency();
+
+  /**
+   * Call this method to make the debug messages asynchronous. Messages are
+   * then written to a buffer of BUTTON_EXECUTOR_LOG_BUFFER_SIZE bytes and a
+   * few bytes at a time are written to the Print output on every call to the
+   * loop method, but only as many as it reports room for with its
+   * availableForWrite method (HardwareSerial does). Logging then never blocks
+   * the loop method. Messages that do not fit in the buffer are dropped whole
+   * and counted (see getDroppedLogMessages method).
+   *
+   * Asynchronous logging is only available when
+   * BUTTON_EXECUTOR_LOG_BUFFER_SIZE is defined to be larger than 0, 64 bytes
+   * is enough for a few messages. Otherwise messages are always printed
+   * immediately.
+   *
+   * isAsync - True to buffer the messages, false to print them immediately.
+   */
+  void setAsyncLogging(boolean isAsync);
+
+  /**
+   * Call this method to print numeric message ids, such as #5, instead of the
+   * text of the debug messages. This reduces the time spent writing to the
+   * Print output. The README contains the table to decode the ids.
+   *
+   * isLoggingIds - True to print message ids, false to print the text.
+   */
+  void setLogMessageIds(boolean isLoggingIds);
+
+  /**
+   * Returns the number of messages dropped because the asynchronous logging
+   * buffer was full.
+   */
+  unsigned long getDroppedLogMessages();
+
+  /**
+   * Call this method to copy the events currently in the trace, oldest first.
+   * The trace is only recorded when BUTTON_EXECUTOR_TRACE_SIZE is defined to
+   * be larger than 0, it then keeps the last BUTTON_EXECUTOR_TRACE_SIZE
+   * events of every callback dispatch, start, stop and button edge.
+   *
+   * events - Array to copy the events into.
+   * maxEvents - Size of the events array.
+   * Returns the number of events copied.
+   */
+  uint16_t getTrace(TraceEvent* events, uint16_t maxEvents);
+
+  /**
+   * Call this method to print the events currently in the trace, oldest
+   * first, to the Print output given to the constructor. Printing is slow, so
+   * this should be called when the timeline is needed, not from callbacks.
+   */
+  void dumpTrace();
+
+  /**
+   * Call this method to remove all events from the trace.
+   */
+  void clearTrace();
+
+  /**
+   * Returns the number of callbacks currently registered.
+   */
+  uint8_t getNumberOfCallbacks();
+
+  /**
+   * Call this method to check the internal bookkeeping of the registered
+   * callbacks, for example after a long random sequence of calls in a test.
+   * Every registered callback must have a unique reference, only registered
+   * callbacks can have a drain callback, and with the schedulers included
+   * with this library the scheduler must have exactly one event per
+   * registered callback plus the one that checks the button.
+   *
+   * Returns true if the bookkeeping is consistent.
+   */
+  boolean checkIntegrity();
+
   /**
    * Call at any time to abort any current execution. This is the code
    * equivalent of pushing the button to stop execution.
+   *
+   * When called from inside a callback, no other callbacks are called for the
+   * rest of the current pass of the loop method and the execution is stopped
+   * at the end of the pass.
    */
   void abortExecution();
 };
@@ -0,0 +1,166 @@
+/**
+ * Code written by Mark Womack
+ * Distributed under the Apache License 2.0, a copy of which should accompany
+ * this file.
+ */
+
+#include "ButtonExecutorSimulator.h"
+
+ButtonExecutorSimulator* ButtonExecutorSimulator::_active = NULL;
+SimulatedDispatchTimer* SimulatedDispatchTimer::_timers = NULL;
+
+SimulatedDispatchTimer::SimulatedDispatchTimer() {
+  _periodInMicros = 0;
+  _nextMicros = 0;
+  _callback = NULL;
+  _interrupts = 0;
+
+  // Every timer is known to the simulator
+  _nextTimer = _timers;
+  _timers = this;
+}
+
+SimulatedDispatchTimer::~SimulatedDispatchTimer() {
+  SimulatedDispatchTimer** timer = &_timers;
+  while (*timer != this) {
+    timer = &(*timer)->_nextTimer;
+  }
+  *timer = _nextTimer;
+}
+
+boolean SimulatedDispatchTimer::start(unsigned long periodInMicros,
+    void (*callback)(void)) {
+  if (periodInMicros == 0 || !ButtonExecutorSimulator::_active) {
+    return false;
+  }
+
+  _periodInMicros = periodInMicros;
+  _nextMicros = ButtonExecutorSimulator::_active->_nowMicros + periodInMicros;
+  _callback = callback;
+  return true;
+}
+
+void SimulatedDispatchTimer::stop() {
+  _callback = NULL;
+}
+
+unsigned long SimulatedDispatchTimer::getInterrupts() {
+  return _interrupts;
+}
+
+ButtonExecutorSimulator::ButtonExecutorSimulator() {
+  _buttonExecutor = NULL;
+  _edges = NULL;
+  _numberOfEdges = 0;
+  _nextEdge = 0;
+  _bounces = 0;
+  _bounceInMicros = 0;
+  _nowMicros = 0;
+  _loops = 0;
+}
+
+void ButtonExecutorSimulator::begin(ButtonExecutor* buttonExecutor,
+    uint8_t buttonPin, uint8_t releasedLevel) {
+  _buttonExecutor = buttonExecutor;
+  _buttonPin = buttonPin;
+  _releasedLevel = releasedLevel;
+  _nowMicros = 0;
+  _loops = 0;
+  _active = this;
+
+  _buttonExecutor->setClock(ButtonExecutorSimulator::millis,
+    ButtonExecutorSimulator::micros);
+  _buttonExecutor->setPinReader(ButtonExecutorSimulator::readPin);
+}
+
+void ButtonExecutorSimulator::setScript(const ButtonScriptEdge* edges,
+    uint16_t numberOfEdges, uint8_t bounces, unsigned long bounceInMicros) {
+  _edges = edges;
+  _numberOfEdges = numberOfEdges;
+  _nextEdge = 0;
+  _bounces = bounces;
+  _bounceInMicros = bounceInMicros;
+}
+
+void ButtonExecutorSimulator::runUntil(unsigned long timeInMs,
+    unsigned long stepInMicros) {
+  unsigned long long endMicros = 1000ULL * timeInMs;
+  while (_nowMicros < endMicros) {
+    _buttonExecutor->loop();
+    _loops++;
+    advanceTo(_nowMicros + stepInMicros);
+  }
+}
+
+void ButtonExecutorSimulator::busyWait(unsigned long timeInMicros) {
+  advanceTo(_nowMicros + timeInMicros);
+}
+
+/**
+ * Advances the simulated clock, calling the callbacks of the started timers
+ * that are due on the way, earliest first.
+ */
+void ButtonExecutorSimulator::advanceTo(unsigned long long timeInMicros) {
+  while (true) {
+    SimulatedDispatchTimer* dueTimer = NULL;
+    for(SimulatedDispatchTimer* timer = SimulatedDispatchTimer::_timers;
+        timer; timer = timer->_nextTimer) {
+      if (timer->_callback && timer->_nextMicros <= timeInMicros
+          && (!dueTimer || timer->_nextMicros < dueTimer->_nextMicros)) {
+        dueTimer = timer;
+      }
+    }
+    if (!dueTimer) {
+      break;
+    }
+
+    _nowMicros = dueTimer->_nextMicros;
+    dueTimer->_nextMicros += dueTimer->_periodInMicros;
+    dueTimer->_interrupts++;
+    (*(dueTimer->_callback))();
+  }
+  _nowMicros = timeInMicros;
+}
+
+unsigned long ButtonExecutorSimulator::getLoops() {
+  return _loops;
+}
+
+unsigned long ButtonExecutorSimulator::millis(void) {
+  return (unsigned long)(_active->_nowMicros / 1000);
+}
+
+unsigned long ButtonExecutorSimulator::micros(void) {
+  return (unsigned long)_active->_nowMicros;
+}
+
+int ButtonExecutorSimulator::readPin(uint8_t pin) {
+  ButtonExecutorSimulator* simulator = _active;
+  if (pin != simulator->_buttonPin) {
+    return LOW;
+  }
+
+  // Move past the edges that have happened, time only goes forward
+  unsigned long long now = simulator->_nowMicros;
+  while (simulator->_nextEdge < simulator->_numberOfEdges
+      && 1000ULL * simulator->_edges[simulator->_nextEdge].timeInMs <= now) {
+    simulator->_nextEdge++;
+  }
+  if (simulator->_nextEdge == 0) {
+    return simulator->_releasedLevel;
+  }
+
+  const ButtonScriptEdge& edge = simulator->_edges[simulator->_nextEdge - 1];
+  uint8_t level = edge.level;
+
+  // While bouncing, the pin alternates between the new and the old level
+  unsigned long long sinceEdge = now - 1000ULL * edge.timeInMs;
+  if (simulator->_bounces > 0 && sinceEdge < simulator->_bounceInMicros) {
+    unsigned long phase = (unsigned long)(sinceEdge * 2 * simulator->_bounces
+      / simulator->_bounceInMicros);
+    if (phase % 2 == 1) {
+      level = !level;
+    }
+  }
+  return level;
+}
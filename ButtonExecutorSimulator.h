@@ -0,0 +1,150 @@
+/**
+ * Code written by Mark Womack
+ * Distributed under the Apache License 2.0, a copy of which should accompany
+ * this file.
+ *
+ * Runs a ButtonExecutor on a simulated clock and replays a script of button
+ * edges, including bounce noise, so the exact timing of the start, stop and
+ * callback calls can be checked deterministically and much faster than real
+ * time. The ButtonExecutor must be built with BUTTON_EXECUTOR_SCHEDULER
+ * defined as BUTTON_EXECUTOR_LINEAR_SCHEDULER or
+ * BUTTON_EXECUTOR_TIMING_WHEEL_SCHEDULER, and with
+ * BUTTON_EXECUTOR_TRACE_SIZE large enough to record what happened (see
+ * ButtonExecutor.getTrace). Please see the examples for guidance.
+ *
+ * SimulatedDispatchTimer simulates a hardware timer on the simulated clock,
+ * its callback is called at the exact simulated time of every interrupt,
+ * between the calls to the loop method.
+ */
+
+#ifndef BUTTON_EXECUTOR_SIMULATOR_H
+#define BUTTON_EXECUTOR_SIMULATOR_H
+
+#include <Arduino.h>
+#include <inttypes.h>
+#include "ButtonExecutor.h"
+#include "DispatchTimer.h"
+
+/**
+ * A scripted change of the button pin. When bounce is simulated, the pin
+ * toggles a number of times before it settles on the new level.
+ */
+struct ButtonScriptEdge {
+  unsigned long timeInMs;
+  uint8_t level;
+};
+
+/**
+ * A DispatchTimer that is driven by the active ButtonExecutorSimulator.
+ */
+class SimulatedDispatchTimer : public DispatchTimer {
+
+public:
+  SimulatedDispatchTimer();
+  ~SimulatedDispatchTimer();
+
+  boolean start(unsigned long periodInMicros, void (*callback)(void));
+  void stop();
+
+  /**
+   * Returns the number of times the callback has been called.
+   */
+  unsigned long getInterrupts();
+
+private:
+  friend class ButtonExecutorSimulator;
+
+  unsigned long _periodInMicros;
+  unsigned long long _nextMicros;
+  void (*_callback)(void);
+  unsigned long _interrupts;
+  SimulatedDispatchTimer* _nextTimer;
+
+  static SimulatedDispatchTimer* _timers;
+};
+
+class ButtonExecutorSimulator {
+
+public:
+  ButtonExecutorSimulator();
+
+  /**
+   * Installs the simulated clock and button pin on the ButtonExecutor. Call
+   * this method before the ButtonExecutor.setup method. The simulated clock
+   * starts at 0. Only one simulator can be active at a time.
+   *
+   * buttonExecutor - The ButtonExecutor to simulate.
+   * buttonPin - Pin number that the ButtonExecutor monitors.
+   * releasedLevel - Level of the button pin before the first scripted edge.
+   */
+  void begin(ButtonExecutor* buttonExecutor, uint8_t buttonPin,
+    uint8_t releasedLevel);
+
+  /**
+   * Sets the script of button edges to replay. The edges must be in order of
+   * time and the array must remain valid while the simulator runs.
+   *
+   * edges - Array of scripted edges.
+   * numberOfEdges - Number of edges in the array.
+   * bounces - Number of times the pin toggles after every edge before it
+   *   settles, 0 for a clean edge.
+   * bounceInMicros - Period of time, in microseconds, that the pin bounces.
+   */
+  void setScript(const ButtonScriptEdge* edges, uint16_t numberOfEdges,
+    uint8_t bounces, unsigned long bounceInMicros);
+
+  /**
+   * Calls the ButtonExecutor.loop method, advancing the simulated clock by
+   * stepInMicros after every call, until the simulated clock reaches
+   * timeInMs. The callbacks of started SimulatedDispatchTimers are called
+   * at their exact time while the clock advances.
+   *
+   * timeInMs - Simulated time, in milliseconds, to run until.
+   * stepInMicros - Simulated time, in microseconds, that every call to the
+   *   loop method takes.
+   */
+  void runUntil(unsigned long timeInMs, unsigned long stepInMicros);
+
+  /**
+   * Call this method from inside a callback to simulate code that runs for
+   * timeInMicros without returning, such as a loop that is stuck. The
+   * simulated clock advances and the callbacks of the started
+   * SimulatedDispatchTimers that are due are called, like interrupts, before
+   * this method returns.
+   *
+   * timeInMicros - Simulated time, in microseconds, to run for.
+   */
+  void busyWait(unsigned long timeInMicros);
+
+  /**
+   * Returns the number of calls to the ButtonExecutor.loop method so far.
+   */
+  unsigned long getLoops();
+
+  /**
+   * The simulated clock and button pin, installed by the begin method.
+   */
+  static unsigned long millis(void);
+  static unsigned long micros(void);
+  static int readPin(uint8_t pin);
+
+private:
+  friend class SimulatedDispatchTimer;
+
+  void advanceTo(unsigned long long timeInMicros);
+
+  ButtonExecutor* _buttonExecutor;
+  uint8_t _buttonPin;
+  uint8_t _releasedLevel;
+  const ButtonScriptEdge* _edges;
+  uint16_t _numberOfEdges;
+  uint16_t _nextEdge;
+  uint8_t _bounces;
+  unsigned long _bounceInMicros;
+  unsigned long long _nowMicros;
+  unsigned long _loops;
+
+  static ButtonExecutorSimulator* _active;
+};
+
+#endif
@@ -0,0 +1,43 @@
+/**
+ * Code written by Mark Womack
+ * Distributed under the Apache License 2.0, a copy of which should accompany
+ * this file.
+ *
+ * Interface of a hardware timer that calls a callback from its interrupt at a
+ * fixed rate, used by ButtonExecutor.callbackEveryByMicros for high-rate
+ * callbacks that can not wait for the loop method, such as generating stepper
+ * pulses. AvrTimer1DispatchTimer.h implements it with Timer1 on AVR, and
+ * SimulatedDispatchTimer (see ButtonExecutorSimulator.h) on a simulated clock.
+ */
+
+#ifndef DISPATCH_TIMER_H
+#define DISPATCH_TIMER_H
+
+#include <Arduino.h>
+#include <inttypes.h>
+
+class DispatchTimer {
+
+public:
+  virtual ~DispatchTimer() {}
+
+  /**
+   * Starts calling the callback from the timer interrupt every
+   * periodInMicros, starting one period from now.
+   *
+   * periodInMicros - Period of time, in microseconds, to call the callback.
+   * callback - Callback method that should be called. It is called from an
+   *   interrupt, so it must be short and only use volatile variables.
+   * Returns true if the timer was started, false if the timer can not
+   *   generate the period.
+   */
+  virtual boolean start(unsigned long periodInMicros,
+    void (*callback)(void)) = 0;
+
+  /**
+   * Stops the timer. The callback is not called after this method returns.
+   */
+  virtual void stop() = 0;
+};
+
+#endif
@@ -0,0 +1,129 @@
+/**
+ * Code written by Mark Womack
+ * Distributed under the Apache License 2.0, a copy of which should accompany
+ * this file.
+ */
+
+#include "FreeRTOSScheduler.h"
+
+#ifdef FREERTOS_SCHEDULER_AVAILABLE
+
+FreeRTOSScheduler::FreeRTOSScheduler() {
+  for(int index = 0; index < FREERTOS_SCHEDULER_MAX_EVENTS; index++) {
+    _events[index].timer = NULL;
+    _events[index].callback = NULL;
+    _events[index].isDue = false;
+    _events[index].scheduler = this;
+  }
+  _task = NULL;
+}
+
+int16_t FreeRTOSScheduler::every(unsigned long period,
+    void (*callback)(void)) {
+  // Timers do not support periods of more than half the tick counter
+  unsigned long long ticks =
+    (unsigned long long)period * configTICK_RATE_HZ / 1000;
+  if (ticks > portMAX_DELAY / 2) {
+    return FREERTOS_SCHEDULER_NO_EVENT_AVAILABLE;
+  }
+  if (ticks == 0) {
+    ticks = 1;
+  }
+
+  // A stopped timer can still expire until the timer service stops it, so
+  // events with idle timers are preferred, but a just stopped event is
+  // reused rather than failing
+  int freeIndex = FREERTOS_SCHEDULER_NO_EVENT_AVAILABLE;
+  for(int index = 0; index < FREERTOS_SCHEDULER_MAX_EVENTS; index++) {
+    Event& event = _events[index];
+    if (event.callback) {
+      continue;
+    }
+
+    if (!event.timer || !xTimerIsTimerActive(event.timer)) {
+      freeIndex = index;
+      break;
+    }
+    if (freeIndex == FREERTOS_SCHEDULER_NO_EVENT_AVAILABLE) {
+      freeIndex = index;
+    }
+  }
+
+  if (freeIndex == FREERTOS_SCHEDULER_NO_EVENT_AVAILABLE) {
+    // All events are in use!
+    return FREERTOS_SCHEDULER_NO_EVENT_AVAILABLE;
+  }
+  Event& event = _events[freeIndex];
+
+  // Timers are created on first use, then kept
+  if (!event.timer) {
+    event.timer = xTimerCreate("ButtonExecutor", (TickType_t)ticks, pdTRUE,
+      &event, timerExpired);
+    if (!event.timer) {
+      return FREERTOS_SCHEDULER_NO_EVENT_AVAILABLE;
+    }
+  }
+
+  // Changing the period also starts the timer, or restarts it from now if
+  // its stop is still queued
+  event.isDue = false;
+  if (xTimerChangePeriod(event.timer, (TickType_t)ticks, portMAX_DELAY)
+      != pdPASS) {
+    return FREERTOS_SCHEDULER_NO_EVENT_AVAILABLE;
+  }
+  event.callback = callback;
+  return freeIndex;
+}
+
+int16_t FreeRTOSScheduler::stop(int16_t id) {
+  if (id >= 0 && id < FREERTOS_SCHEDULER_MAX_EVENTS
+      && _events[id].callback) {
+    _events[id].callback = NULL;
+    xTimerStop(_events[id].timer, portMAX_DELAY);
+  }
+  return FREERTOS_SCHEDULER_NOT_AN_EVENT;
+}
+
+uint16_t FreeRTOSScheduler::getNumberOfEvents() {
+  uint16_t numberOfEvents = 0;
+  for(int index = 0; index < FREERTOS_SCHEDULER_MAX_EVENTS; index++) {
+    if (_events[index].callback) {
+      numberOfEvents++;
+    }
+  }
+  return numberOfEvents;
+}
+
+void FreeRTOSScheduler::update() {
+#if FREERTOS_SCHEDULER_MAX_WAIT_MS > 0
+  // Sleep until woken by a timer, other tasks can run meanwhile
+  _task = xTaskGetCurrentTaskHandle();
+  ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(FREERTOS_SCHEDULER_MAX_WAIT_MS));
+#endif
+
+  for(int index = 0; index < FREERTOS_SCHEDULER_MAX_EVENTS; index++) {
+    Event& event = _events[index];
+    if (!event.callback || !event.isDue) {
+      continue;
+    }
+
+    event.isDue = false;
+    (*(event.callback))();
+  }
+}
+
+/**
+ * Called by the timer service task when a timer expires. It only marks the
+ * event as due and wakes the task that calls the update method.
+ */
+void FreeRTOSScheduler::timerExpired(TimerHandle_t timer) {
+  Event* event = (Event*)pvTimerGetTimerID(timer);
+  event->isDue = true;
+
+  TaskHandle_t task = event->scheduler->_task;
+  if (task) {
+    xTaskNotifyGive(task);
+  }
+}
+
+#endif
@@ -0,0 +1,117 @@
+/**
+ * Code written by Mark Womack
+ * Distributed under the Apache License 2.0, a copy of which should accompany
+ * this file.
+ *
+ * A scheduler with the same every, stop and update methods as the
+ * LinearScheduler, so it can be used by ButtonExecutor in its place, that
+ * uses the software timers of FreeRTOS on boards that run it, such as the
+ * ESP32 and RP2040. Every event is an auto-reload timer of the timer service,
+ * so its deadlines are kept by the RTOS without drift, like vTaskDelayUntil.
+ *
+ * The timer service only marks the event as due and wakes the task that
+ * calls the update method, which then calls the callbacks itself. Callbacks
+ * therefore still run one at a time on that task. By default the update
+ * method only polls, like the other schedulers, so loop() is never held up.
+ * It can instead be made to sleep until the next timer expires, which leaves
+ * the CPU free for other tasks between deadlines. The clock can not be
+ * replaced, FreeRTOS ticks are always used.
+ */
+
+#ifndef FREERTOS_SCHEDULER_H
+#define FREERTOS_SCHEDULER_H
+
+#include <Arduino.h>
+#include <inttypes.h>
+
+#if defined(ESP32)
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/timers.h>
+#define FREERTOS_SCHEDULER_AVAILABLE
+#elif defined(__has_include)
+#if __has_include(<FreeRTOS.h>)
+#include <FreeRTOS.h>
+#include <task.h>
+#include <timers.h>
+#if configUSE_TIMERS
+#define FREERTOS_SCHEDULER_AVAILABLE
+#endif
+#endif
+#endif
+
+#ifndef FREERTOS_SCHEDULER_MAX_EVENTS
+#define FREERTOS_SCHEDULER_MAX_EVENTS (16)
+#endif
+
+// Longest time, in milliseconds, that the update method sleeps waiting for
+// a timer, 0 to only poll
+#ifndef FREERTOS_SCHEDULER_MAX_WAIT_MS
+#define FREERTOS_SCHEDULER_MAX_WAIT_MS (0)
+#endif
+
+#define FREERTOS_SCHEDULER_NOT_AN_EVENT (-2)
+#define FREERTOS_SCHEDULER_NO_EVENT_AVAILABLE (-1)
+
+#ifdef FREERTOS_SCHEDULER_AVAILABLE
+
+class FreeRTOSScheduler {
+
+public:
+  FreeRTOSScheduler();
+
+  /**
+   * Registers a callback to be called every period milliseconds, starting one
+   * period from now. Periods are rounded down to FreeRTOS ticks, with a
+   * minimum of one tick. Must be called from a task.
+   *
+   * period - Period of time, in milliseconds, to call the callback.
+   * callback - Callback method that should be called.
+   * Returns the id of the event, or FREERTOS_SCHEDULER_NO_EVENT_AVAILABLE if
+   *   all events are in use or a timer could not be created. Events whose
+   *   timers are already stopped are used first, then events that were just
+   *   stopped, whose timers are restarted with the new period.
+   */
+  int16_t every(unsigned long period, void (*callback)(void));
+
+  /**
+   * Stops the event with the given id, its timer is stopped by the timer
+   * service. Its callback is not called again, even if the timer had already
+   * expired. Ids that are not in use are ignored. Must be called from a task.
+   *
+   * id - Id of the event returned by the every method.
+   * Returns FREERTOS_SCHEDULER_NOT_AN_EVENT, to be stored in place of the id.
+   */
+  int16_t stop(int16_t id);
+
+  /**
+   * Returns the number of events in use.
+   */
+  uint16_t getNumberOfEvents();
+
+  /**
+   * Calls the callbacks of all events that are due. If
+   * FREERTOS_SCHEDULER_MAX_WAIT_MS is not 0, it first sleeps until a timer
+   * expires, or for at most that long. A callback that expired more than once
+   * since the last update is called once.
+   */
+  void update();
+
+private:
+  // A free event has no callback, its timer is kept for reuse
+  struct Event {
+    TimerHandle_t timer;
+    void (*callback)(void);
+    volatile boolean isDue;
+    FreeRTOSScheduler* scheduler;
+  };
+
+  static void timerExpired(TimerHandle_t timer);
+
+  Event _events[FREERTOS_SCHEDULER_MAX_EVENTS];
+  TaskHandle_t volatile _task;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,73 @@
+/**
+ * Code written by Mark Womack
+ * Distributed under the Apache License 2.0, a copy of which should accompany
+ * this file.
+ */
+
+#include "LinearScheduler.h"
+
+LinearScheduler::LinearScheduler() {
+  for(int index = 0; index < LINEAR_SCHEDULER_MAX_EVENTS; index++) {
+    _events[index].callback = NULL;
+  }
+  _clockMillis = millis;
+}
+
+void LinearScheduler::setClock(unsigned long (*clockMillis)(void)) {
+  _clockMillis = clockMillis;
+}
+
+int16_t LinearScheduler::every(unsigned long period, void (*callback)(void)) {
+  if (period > LINEAR_SCHEDULER_MAX_PERIOD) {
+    return LINEAR_SCHEDULER_NO_EVENT_AVAILABLE;
+  }
+
+  for(int index = 0; index < LINEAR_SCHEDULER_MAX_EVENTS; index++) {
+    if (_events[index].callback) {
+      continue;
+    }
+
+    _events[index].callback = callback;
+    _events[index].period = period;
+    _events[index].lastEventTime = (*(_clockMillis))();
+    return index;
+  }
+
+  // All events are in use!
+  return LINEAR_SCHEDULER_NO_EVENT_AVAILABLE;
+}
+
+int16_t LinearScheduler::stop(int16_t id) {
+  if (id >= 0 && id < LINEAR_SCHEDULER_MAX_EVENTS) {
+    _events[id].callback = NULL;
+  }
+  return LINEAR_SCHEDULER_NOT_AN_EVENT;
+}
+
+uint16_t LinearScheduler::getNumberOfEvents() {
+  uint16_t numberOfEvents = 0;
+  for(int index = 0; index < LINEAR_SCHEDULER_MAX_EVENTS; index++) {
+    if (_events[index].callback) {
+      numberOfEvents++;
+    }
+  }
+  return numberOfEvents;
+}
+
+void LinearScheduler::update() {
+  update((*(_clockMillis))());
+}
+
+void LinearScheduler::update(unsigned long now) {
+  for(int index = 0; index < LINEAR_SCHEDULER_MAX_EVENTS; index++) {
+    Event& event = _events[index];
+    if (!event.callback
+        || (LinearSchedulerTime)(now - event.lastEventTime) < event.period) {
+      continue;
+    }
+
+    // Like the Timer library, the next period starts when the event is due
+    event.lastEventTime = now;
+    (*(event.callback))();
+  }
+}
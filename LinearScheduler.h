@@ -0,0 +1,102 @@
+/**
+ * Code written by Mark Womack
+ * Distributed under the Apache License 2.0, a copy of which should accompany
+ * this file.
+ *
+ * A minimal scheduler with the same interface as the Timer library's every,
+ * stop and update methods, so it can be used by ButtonExecutor in its place.
+ * Unlike the Timer library it takes the current time from a clock method that
+ * can be replaced, which allows the ButtonExecutor to run on a simulated clock.
+ * Events are kept in an array that is scanned linearly on every update.
+ *
+ * Every event takes the size of a method pointer plus two times. When
+ * BUTTON_EXECUTOR_SHORT_PERIODS is defined in the build flags, the times are
+ * kept in 16 bits, relative to the 16 bits of the clock, which limits periods
+ * to 65535 milliseconds. An event then takes 6 bytes on AVR instead of 10,
+ * less than a third of an event of the Timer library.
+ */
+
+#ifndef LINEAR_SCHEDULER_H
+#define LINEAR_SCHEDULER_H
+
+#include <Arduino.h>
+#include <inttypes.h>
+
+#ifndef LINEAR_SCHEDULER_MAX_EVENTS
+#define LINEAR_SCHEDULER_MAX_EVENTS (10)
+#endif
+
+#ifdef BUTTON_EXECUTOR_SHORT_PERIODS
+typedef uint16_t LinearSchedulerTime;
+#define LINEAR_SCHEDULER_MAX_PERIOD (0xFFFFUL)
+#else
+typedef unsigned long LinearSchedulerTime;
+#define LINEAR_SCHEDULER_MAX_PERIOD (0xFFFFFFFFUL)
+#endif
+
+#define LINEAR_SCHEDULER_NOT_AN_EVENT (-2)
+#define LINEAR_SCHEDULER_NO_EVENT_AVAILABLE (-1)
+
+class LinearScheduler {
+
+public:
+  LinearScheduler();
+
+  /**
+   * Call this method to replace the clock used by the scheduler, millis by
+   * default.
+   *
+   * clockMillis - Method that returns the current time in milliseconds.
+   */
+  void setClock(unsigned long (*clockMillis)(void));
+
+  /**
+   * Registers a callback to be called every period milliseconds, starting one
+   * period from now.
+   *
+   * period - Period of time, in milliseconds, to call the callback.
+   * callback - Callback method that should be called.
+   * Returns the id of the event, or LINEAR_SCHEDULER_NO_EVENT_AVAILABLE if all
+   *   events are in use or the period is above LINEAR_SCHEDULER_MAX_PERIOD.
+   */
+  int16_t every(unsigned long period, void (*callback)(void));
+
+  /**
+   * Stops the event with the given id. Ids that are not in use are ignored.
+   *
+   * id - Id of the event returned by the every method.
+   * Returns LINEAR_SCHEDULER_NOT_AN_EVENT, to be stored in place of the id.
+   */
+  int16_t stop(int16_t id);
+
+  /**
+   * Returns the number of events in use.
+   */
+  uint16_t getNumberOfEvents();
+
+  /**
+   * Calls the callbacks of all events that are due at the current time of
+   * the clock.
+   */
+  void update();
+
+  /**
+   * Calls the callbacks of all events that are due at the given time.
+   *
+   * now - Current time in milliseconds.
+   */
+  void update(unsigned long now);
+
+private:
+  // A free event has no callback
+  struct Event {
+    void (*callback)(void);
+    LinearSchedulerTime period;
+    LinearSchedulerTime lastEventTime;
+  };
+
+  Event _events[LINEAR_SCHEDULER_MAX_EVENTS];
+  unsigned long (*_clockMillis)(void);
+};
+
+#endif
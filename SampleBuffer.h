@@ -0,0 +1,204 @@
+/**
+ * Code written by Mark Womack
+ * Distributed under the Apache License 2.0, a copy of which should accompany
+ * this file.
+ *
+ * A fixed-capacity ring buffer that passes samples from a single producer to
+ * a single consumer without locks, for example from a 1 kHz callback that
+ * reads a sensor to a 10 Hz callback that processes the samples in batches.
+ * The producer only writes the head and the consumer only writes the tail, so
+ * either side can run in an interrupt, a timer callback (see
+ * ButtonExecutor.callbackEveryByMicros) or on the second core (see
+ * ButtonExecutor.callbackEveryByMillisOnCore).
+ *
+ * Samples can be written and read in place, with the reserve/commit and
+ * peek/release methods, so they are never copied. When registered with
+ * ButtonExecutor.registerSampleBuffer, the buffer is cleared every time
+ * execution is started and drained by its consumer when execution is stopped.
+ */
+
+#ifndef SAMPLE_BUFFER_H
+#define SAMPLE_BUFFER_H
+
+#include <Arduino.h>
+#include <inttypes.h>
+
+/**
+ * The part of a SampleBuffer that ButtonExecutor uses, independent of the
+ * type and number of samples.
+ */
+class SampleBufferBase {
+
+public:
+  virtual ~SampleBufferBase() {}
+
+  /**
+   * Returns the number of samples that can be read.
+   */
+  virtual uint16_t available() = 0;
+
+  /**
+   * Removes the oldest samples.
+   *
+   * count - Number of samples to remove, at most available.
+   */
+  virtual void release(uint16_t count) = 0;
+
+  /**
+   * Discards all samples and clears the count of dropped samples. Must only
+   * be called while the producer is not running.
+   */
+  virtual void clear() = 0;
+};
+
+// Indexes are read and written in a single instruction, 8 bits where that is
+// enough, so they are never torn by an interrupt
+template<bool IS_SMALL> struct SampleBufferIndex {
+  typedef uint8_t Type;
+};
+
+template<> struct SampleBufferIndex<false> {
+  typedef uint16_t Type;
+};
+
+template<typename T, uint16_t CAPACITY>
+class SampleBuffer : public SampleBufferBase {
+
+  static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0,
+    "SampleBuffer capacity must be a power of two");
+#if defined(__AVR__)
+  static_assert(CAPACITY <= 128,
+    "SampleBuffer capacity must be at most 128 on 8 bit microcontrollers");
+#else
+  static_assert(CAPACITY <= 32768, "SampleBuffer capacity is too large");
+#endif
+
+  // Free running counters, the range must be larger than the capacity
+  typedef typename SampleBufferIndex<(CAPACITY <= 128)>::Type Index;
+
+public:
+  SampleBuffer() {
+    _head = 0;
+    _tail = 0;
+    _dropped = 0;
+  }
+
+  /**
+   * Producer side. Copies the sample into the buffer.
+   *
+   * sample - The sample to add.
+   * Returns true if the sample was added, false if the buffer was full and
+   *   the sample was dropped.
+   */
+  boolean push(const T& sample) {
+    T* slot = reserve();
+    if (!slot) {
+      return false;
+    }
+    *slot = sample;
+    commit();
+    return true;
+  }
+
+  /**
+   * Producer side. Returns the slot of the next sample, to be written in
+   * place and then added with the commit method, or NULL if the buffer is
+   * full. A full buffer counts the sample as dropped.
+   */
+  T* reserve() {
+    Index head = _head;
+    if ((Index)(head - _tail) >= CAPACITY) {
+      _dropped++;
+      return NULL;
+    }
+    return &_samples[head & (CAPACITY - 1)];
+  }
+
+  /**
+   * Producer side. Adds the sample written to the slot returned by the
+   * reserve method.
+   */
+  void commit() {
+    // The sample must be written before the consumer can see it
+    __sync_synchronize();
+    _head = _head + 1;
+  }
+
+  /**
+   * Returns the number of samples dropped because the buffer was full since
+   * it was last cleared. The count is wider than a single instruction on 8
+   * bit microcontrollers, so interrupts are disabled while it is read and
+   * this method must not be called from an interrupt.
+   */
+  unsigned long getDropped() {
+    noInterrupts();
+    unsigned long dropped = _dropped;
+    interrupts();
+    return dropped;
+  }
+
+  /**
+   * Consumer side. Returns the number of samples that can be read.
+   */
+  uint16_t available() {
+    return (Index)(_head - _tail);
+  }
+
+  /**
+   * Consumer side. Returns a sample in place, without removing it.
+   *
+   * index - Index of the sample, 0 for the oldest, less than available.
+   */
+  const T& peek(uint16_t index) {
+    // The sample was written before the head that made it available
+    __sync_synchronize();
+    return _samples[(Index)(_tail + index) & (CAPACITY - 1)];
+  }
+
+  /**
+   * Consumer side. Removes the oldest samples, after they have been read
+   * with the peek method.
+   *
+   * count - Number of samples to remove, at most available.
+   */
+  void release(uint16_t count) {
+    // The samples must be read before the producer can overwrite them
+    __sync_synchronize();
+    _tail = _tail + count;
+  }
+
+  /**
+   * Consumer side. Copies the oldest sample out of the buffer and removes it.
+   *
+   * sample - Where to copy the sample.
+   * Returns true if a sample was read, false if the buffer was empty.
+   */
+  boolean pop(T& sample) {
+    if (available() == 0) {
+      return false;
+    }
+    sample = peek(0);
+    release(1);
+    return true;
+  }
+
+  void clear() {
+    _tail = _head;
+    _dropped = 0;
+  }
+
+  /**
+   * Returns the number of samples the buffer can hold.
+   */
+  uint16_t getCapacity() {
+    return CAPACITY;
+  }
+
+private:
+  T _samples[CAPACITY];
+  volatile Index _head;
+  volatile Index _tail;
+  volatile unsigned long _dropped;
+};
+
+#endif
@@ -0,0 +1,169 @@
+/**
+ * Code written by Mark Womack
+ * Distributed under the Apache License 2.0, a copy of which should accompany
+ * this file.
+ */
+
+#include "TimingWheelScheduler.h"
+
+// Marks the end of a list of events
+static const uint16_t NO_EVENT(0xFFFF);
+
+TimingWheelScheduler::TimingWheelScheduler() {
+  for(int position = 0; position < TIMING_WHEEL_LEVELS * TIMING_WHEEL_SLOTS;
+      position++) {
+    _heads[position] = NO_EVENT;
+  }
+
+  // All events start on the free list
+  for(uint16_t index = 0; index < TIMING_WHEEL_MAX_EVENTS; index++) {
+    _events[index].callback = NULL;
+    _events[index].next = index + 1 < TIMING_WHEEL_MAX_EVENTS
+      ? index + 1 : NO_EVENT;
+  }
+  _freeHead = 0;
+  _numberOfEvents = 0;
+  _currentTick = 0;
+  _clockMillis = millis;
+}
+
+void TimingWheelScheduler::setClock(unsigned long (*clockMillis)(void)) {
+  _clockMillis = clockMillis;
+}
+
+int16_t TimingWheelScheduler::every(unsigned long period,
+    void (*callback)(void)) {
+  if (_freeHead == NO_EVENT) {
+    // All events are in use!
+    return TIMING_WHEEL_NO_EVENT_AVAILABLE;
+  }
+
+  // The wheel does not turn while empty, catch up with the clock
+  unsigned long now = (*(_clockMillis))();
+  if (_numberOfEvents == 0) {
+    _currentTick = now;
+  }
+
+  uint16_t index = _freeHead;
+  Event& event = _events[index];
+  _freeHead = event.next;
+  event.callback = callback;
+  event.period = period;
+  event.deadline = now + (period > 0 ? period : 1);
+  link(index);
+  _numberOfEvents++;
+  return index;
+}
+
+int16_t TimingWheelScheduler::stop(int16_t id) {
+  if (id >= 0 && id < TIMING_WHEEL_MAX_EVENTS && _events[id].callback) {
+    unlink(id);
+    _events[id].callback = NULL;
+    _events[id].next = _freeHead;
+    _freeHead = id;
+    _numberOfEvents--;
+  }
+  return TIMING_WHEEL_NOT_AN_EVENT;
+}
+
+uint16_t TimingWheelScheduler::getNumberOfEvents() {
+  return _numberOfEvents;
+}
+
+void TimingWheelScheduler::update() {
+  update((*(_clockMillis))());
+}
+
+void TimingWheelScheduler::update(unsigned long now) {
+  if (_numberOfEvents == 0) {
+    _currentTick = now;
+    return;
+  }
+
+  while ((long)(now - _currentTick) > 0) {
+    unsigned long tick = ++_currentTick;
+
+    // Move events down from the levels whose slot is reached, top down
+    for(int level = TIMING_WHEEL_LEVELS - 1; level > 0; level--) {
+      unsigned long mask = (1UL << (level * TIMING_WHEEL_SLOT_BITS)) - 1;
+      if ((tick & mask) == 0) {
+        cascade(level * TIMING_WHEEL_SLOTS
+          + ((tick >> (level * TIMING_WHEEL_SLOT_BITS))
+            & (TIMING_WHEEL_SLOTS - 1)));
+      }
+    }
+
+    // Call every event in the slot of this tick. Rescheduled events never
+    // return to this slot, so take them from the head until it is empty.
+    uint16_t position = tick & (TIMING_WHEEL_SLOTS - 1);
+    while (_heads[position] != NO_EVENT) {
+      uint16_t index = _heads[position];
+      Event& event = _events[index];
+      unlink(index);
+      event.deadline = now + (event.period > 0 ? event.period : 1);
+      link(index);
+      (*(event.callback))();
+    }
+  }
+}
+
+/**
+ * Adds the event to the slot for its deadline, at the lowest level that
+ * reaches it. Deadlines beyond the top level wait in its last slot and are
+ * placed again when that slot is reached.
+ */
+void TimingWheelScheduler::link(uint16_t index) {
+  Event& event = _events[index];
+  unsigned long delta = event.deadline - _currentTick;
+  unsigned long deadline = event.deadline;
+  int level = 0;
+  while (level < TIMING_WHEEL_LEVELS - 1
+      && delta >= (1UL << ((level + 1) * TIMING_WHEEL_SLOT_BITS))) {
+    level++;
+  }
+  if (level == TIMING_WHEEL_LEVELS - 1 && delta
+      >= (1UL << (TIMING_WHEEL_LEVELS * TIMING_WHEEL_SLOT_BITS)) - 1) {
+    deadline = _currentTick
+      + (1UL << (TIMING_WHEEL_LEVELS * TIMING_WHEEL_SLOT_BITS)) - 1;
+  }
+
+  uint16_t position = level * TIMING_WHEEL_SLOTS
+    + ((deadline >> (level * TIMING_WHEEL_SLOT_BITS))
+      & (TIMING_WHEEL_SLOTS - 1));
+  event.position = position;
+  event.previous = NO_EVENT;
+  event.next = _heads[position];
+  if (event.next != NO_EVENT) {
+    _events[event.next].previous = index;
+  }
+  _heads[position] = index;
+}
+
+/**
+ * Removes the event from the slot it is in.
+ */
+void TimingWheelScheduler::unlink(uint16_t index) {
+  Event& event = _events[index];
+  if (event.previous != NO_EVENT) {
+    _events[event.previous].next = event.next;
+  } else {
+    _heads[event.position] = event.next;
+  }
+  if (event.next != NO_EVENT) {
+    _events[event.next].previous = event.previous;
+  }
+}
+
+/**
+ * Places every event of a slot of a higher level again, which moves it down
+ * to the level below.
+ */
+void TimingWheelScheduler::cascade(uint16_t position) {
+  uint16_t index = _heads[position];
+  _heads[position] = NO_EVENT;
+  while (index != NO_EVENT) {
+    uint16_t next = _events[index].next;
+    link(index);
+    index = next;
+  }
+}
@@ -0,0 +1,111 @@
+/**
+ * Code written by Mark Womack
+ * Distributed under the Apache License 2.0, a copy of which should accompany
+ * this file.
+ *
+ * A hierarchical timing wheel scheduler with the same interface as the
+ * LinearScheduler, so it can be used by ButtonExecutor in its place. It is
+ * meant for microcontrollers with more memory that run hundreds of callbacks:
+ * registering and stopping an event takes constant time, and every tick of
+ * the clock takes amortized constant time, no matter how many events there
+ * are. The ButtonExecutor itself keeps callback ids in an int8_t, so with it
+ * TIMING_WHEEL_MAX_EVENTS can be at most 128.
+ *
+ * The wheel has TIMING_WHEEL_LEVELS levels of 64 slots. Level 0 has a slot for
+ * every millisecond of the next 64 milliseconds, level 1 a slot for every 64
+ * milliseconds of the next 4096 milliseconds, and so on. Events are moved
+ * down a level when the wheel below has turned around to their slot.
+ */
+
+#ifndef TIMING_WHEEL_SCHEDULER_H
+#define TIMING_WHEEL_SCHEDULER_H
+
+#include <Arduino.h>
+#include <inttypes.h>
+
+#ifndef TIMING_WHEEL_MAX_EVENTS
+#define TIMING_WHEEL_MAX_EVENTS (64)
+#endif
+
+#define TIMING_WHEEL_LEVELS (4)
+#define TIMING_WHEEL_SLOT_BITS (6)
+#define TIMING_WHEEL_SLOTS (1 << TIMING_WHEEL_SLOT_BITS)
+
+#define TIMING_WHEEL_NOT_AN_EVENT (-2)
+#define TIMING_WHEEL_NO_EVENT_AVAILABLE (-1)
+
+class TimingWheelScheduler {
+
+public:
+  TimingWheelScheduler();
+
+  /**
+   * Call this method to replace the clock used by the scheduler, millis by
+   * default.
+   *
+   * clockMillis - Method that returns the current time in milliseconds.
+   */
+  void setClock(unsigned long (*clockMillis)(void));
+
+  /**
+   * Registers a callback to be called every period milliseconds, starting one
+   * period from now. A period of 0 calls the callback every millisecond.
+   *
+   * period - Period of time, in milliseconds, to call the callback.
+   * callback - Callback method that should be called.
+   * Returns the id of the event, or TIMING_WHEEL_NO_EVENT_AVAILABLE if all
+   *   events are in use.
+   */
+  int16_t every(unsigned long period, void (*callback)(void));
+
+  /**
+   * Stops the event with the given id. Ids that are not in use are ignored.
+   *
+   * id - Id of the event returned by the every method.
+   * Returns TIMING_WHEEL_NOT_AN_EVENT, to be stored in place of the id.
+   */
+  int16_t stop(int16_t id);
+
+  /**
+   * Returns the number of events in use.
+   */
+  uint16_t getNumberOfEvents();
+
+  /**
+   * Calls the callbacks of all events that are due at the current time of
+   * the clock.
+   */
+  void update();
+
+  /**
+   * Calls the callbacks of all events that are due at the given time. Like
+   * the Timer library, an event that is called late starts its next period
+   * at the given time.
+   *
+   * now - Current time in milliseconds.
+   */
+  void update(unsigned long now);
+
+private:
+  struct Event {
+    void (*callback)(void);
+    unsigned long period;
+    unsigned long deadline;
+    uint16_t next;
+    uint16_t previous;
+    uint16_t position;
+  };
+
+  void link(uint16_t index);
+  void unlink(uint16_t index);
+  void cascade(uint16_t position);
+
+  Event _events[TIMING_WHEEL_MAX_EVENTS];
+  uint16_t _heads[TIMING_WHEEL_LEVELS * TIMING_WHEEL_SLOTS];
+  uint16_t _freeHead;
+  uint16_t _numberOfEvents;
+  unsigned long _currentTick;
+  unsigned long (*_clockMillis)(void);
+};
+
+#endif
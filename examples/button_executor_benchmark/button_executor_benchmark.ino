@@ -0,0 +1,101 @@
+/**
+ * Code written by Mark Womack
+ * Distributed under the Apache License 2.0, a copy of which should accompany
+ * this file.
+ *
+ * Example code that compares the cost of the schedulers included with this
+ * library. Each scheduler is loaded with 10, 100 and 1000 callbacks with
+ * random periods, and is then updated once for every millisecond of 10
+ * simulated seconds. The average time of an update, in microseconds, is
+ * printed for each. No circuit is needed.
+ *
+ * Counts that are larger than the capacity of a scheduler are skipped. To
+ * benchmark all of them, build with these flags on a board with enough
+ * memory, for example in the build_flags of a PlatformIO project:
+ *   -DLINEAR_SCHEDULER_MAX_EVENTS=1000
+ *   -DTIMING_WHEEL_MAX_EVENTS=1000
+ */
+
+#include <LinearScheduler.h>
+#include <TimingWheelScheduler.h>
+
+#define SIMULATED_MS (10000)
+#define MIN_PERIOD_MS (1)
+#define MAX_PERIOD_MS (5000)
+#define MAX_TASKS (LINEAR_SCHEDULER_MAX_EVENTS > TIMING_WHEEL_MAX_EVENTS \
+  ? LINEAR_SCHEDULER_MAX_EVENTS : TIMING_WHEEL_MAX_EVENTS)
+
+const int taskCounts[] = { 10, 100, 1000 };
+
+LinearScheduler linearScheduler;
+TimingWheelScheduler timingWheelScheduler;
+
+int16_t ids[MAX_TASKS];
+unsigned long simulatedTime;
+unsigned long calls;
+
+// Registers tasks callbacks with the scheduler and times its updates
+template <typename SCHEDULER>
+void benchmark(const char* name, SCHEDULER& scheduler, int capacity,
+    int tasks) {
+  Serial.print(name);
+  Serial.print(", ");
+  Serial.print(tasks);
+  Serial.print(", ");
+  if (tasks > capacity) {
+    Serial.println("skipped");
+    return;
+  }
+
+  // Same periods for every scheduler
+  randomSeed(tasks);
+  simulatedTime = 0;
+  for (int i = 0; i < tasks; i++) {
+    ids[i] = scheduler.every(random(MIN_PERIOD_MS, MAX_PERIOD_MS + 1),
+      countCallback);
+  }
+
+  calls = 0;
+  unsigned long startTime = micros();
+  while (simulatedTime < SIMULATED_MS) {
+    simulatedTime++;
+    scheduler.update();
+  }
+  unsigned long elapsedTime = micros() - startTime;
+
+  for (int i = 0; i < tasks; i++) {
+    scheduler.stop(ids[i]);
+  }
+
+  Serial.print((float)elapsedTime / SIMULATED_MS);
+  Serial.print(", ");
+  Serial.println(calls);
+}
+
+unsigned long simulatedMillis(void) {
+  return simulatedTime;
+}
+
+void countCallback(void) {
+  calls++;
+}
+
+void setup() {
+  Serial.begin(9600);
+
+  // The schedulers run on a simulated clock, while their updates are timed
+  // with the real one
+  linearScheduler.setClock(simulatedMillis);
+  timingWheelScheduler.setClock(simulatedMillis);
+
+  Serial.println("Scheduler, tasks, us per tick, calls");
+  for (unsigned int i = 0; i < sizeof(taskCounts) / sizeof(taskCounts[0]); i++) {
+    benchmark("Linear", linearScheduler, LINEAR_SCHEDULER_MAX_EVENTS,
+      taskCounts[i]);
+    benchmark("TimingWheel", timingWheelScheduler, TIMING_WHEEL_MAX_EVENTS,
+      taskCounts[i]);
+  }
+}
+
+void loop() {
+}
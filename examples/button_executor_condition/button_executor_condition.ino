@@ -0,0 +1,80 @@
+/**
+ * Code written by Mark Womack
+ * Distributed under the Apache License 2.0, a copy of which should accompany
+ * this file.
+ * 
+ * Example code that demonstrates callbacks on conditions. The LED on pin 13
+ * turns on when the analog input goes above a threshold and off when it goes
+ * back below, and the time the threshold was first crossed is printed once
+ * per execution. You will need the basic circuit with a momentary push
+ * button connected to pin 12, and a potentiometer connected to A0.
+ *
+ * The library must be built with this flag, for example in the build_flags
+ * of a PlatformIO project:
+ *   -DBUTTON_EXECUTOR_CONDITIONS=3
+ */
+ 
+#include <ButtonExecutor.h>
+
+#if BUTTON_EXECUTOR_CONDITIONS < 3
+#error "This example requires BUTTON_EXECUTOR_CONDITIONS of 3 or more"
+#endif
+
+ButtonExecutor buttonExecutor(&Serial);
+
+#define THRESHOLD (512)
+
+unsigned long startTime;
+
+void setup() {
+  Serial.begin(9600);
+
+  pinMode(13, OUTPUT);
+
+  // Monitor pin 12 for button pushes which will be HIGH
+  buttonExecutor.setup(12, HIGH, sketchSetup, sketchStart, sketchStop);
+}
+
+void loop() {
+  buttonExecutor.loop();
+}
+
+// Called when the buttonExecutor is set up
+void sketchSetup(void) {
+  // All three conditions are evaluated in the same pass, 20 times a second
+  buttonExecutor.callbackWhen(&isAbove, 50, &aboveCallback);
+  buttonExecutor.callbackWhen(&isBelow, 50, &belowCallback);
+  buttonExecutor.callbackOnceWhen(&isAbove, 50, &firstAboveCallback);
+}
+
+// Called when the buttonExecutor is started with button push
+void sketchStart(void) {
+  startTime = millis();
+  digitalWrite(13, isAbove() ? HIGH : LOW);
+}
+
+// Called when buttonExecutor stopped with button push
+void sketchStop(void) {
+  digitalWrite(13, LOW);
+}
+
+boolean isAbove(void) {
+  return analogRead(A0) > THRESHOLD;
+}
+
+boolean isBelow(void) {
+  return !isAbove();
+}
+
+void aboveCallback(void) {
+  digitalWrite(13, HIGH);
+}
+
+void belowCallback(void) {
+  digitalWrite(13, LOW);
+}
+
+void firstAboveCallback(void) {
+  Serial.print("First above threshold after ms: ");
+  Serial.println(millis() - startTime);
+}
@@ -0,0 +1,97 @@
+/**
+ * Code written by Mark Womack
+ * Distributed under the Apache License 2.0, a copy of which should accompany
+ * this file.
+ * 
+ * Example code that demonstrates running callbacks on the second core of a
+ * dual-core microcontroller, an RP2040 or ESP32. A busy callback on the
+ * second core keeps a running average of an analog input, while a callback
+ * on the main core reports it once a second and is never delayed by it. The
+ * button still starts and stops both. You will need the basic circuit with a
+ * momentary push button connected to pin 12, and anything connected to A0.
+ *
+ * The library must be built with this flag, for example in the build_flags
+ * of a PlatformIO project:
+ *   -DBUTTON_EXECUTOR_CORE_CALLBACKS=4
+ */
+ 
+#include <ButtonExecutor.h>
+
+#if BUTTON_EXECUTOR_CORE_CALLBACKS == 0
+#error "This example requires BUTTON_EXECUTOR_CORE_CALLBACKS"
+#endif
+#if !defined(ARDUINO_ARCH_RP2040) && !defined(ESP32)
+#error "This example requires an RP2040 or ESP32"
+#endif
+
+ButtonExecutor buttonExecutor(&Serial);
+
+// Shared between the cores, so volatile
+volatile int average;
+
+void setup() {
+  Serial.begin(9600);
+
+  // Monitor pin 12 for button pushes which will be HIGH
+  buttonExecutor.setup(12, HIGH, sketchSetup, sketchStart, sketchStop);
+
+#if defined(ESP32)
+  // The Arduino loop runs on core 1, so the second core is core 0
+  xTaskCreatePinnedToCore(secondCoreTask, "loop1", 4096, NULL, 1, NULL, 0);
+#endif
+}
+
+void loop() {
+  buttonExecutor.loop();
+}
+
+#if defined(ARDUINO_ARCH_RP2040)
+// Called repeatedly on the second core of the RP2040
+void loop1() {
+  buttonExecutor.loop1();
+}
+#else
+void secondCoreTask(void* parameters) {
+  while (true) {
+    buttonExecutor.loop1();
+    // Let the idle task of the core feed its watchdog
+    vTaskDelay(1);
+  }
+}
+#endif
+
+// Called when the buttonExecutor is set up
+void sketchSetup(void) {
+  average = 0;
+}
+
+// Called when the buttonExecutor is started with button push
+void sketchStart(void) {
+  // Called every 5 milliseconds on the second core
+  buttonExecutor.callbackEveryByMillisOnCore(5, &sampleCallback, SECOND_CORE);
+
+  // Called every second on the main core
+  buttonExecutor.callbackEveryByMillisOnCore(1000, &reportCallback,
+    MAIN_CORE);
+}
+
+// Called when buttonExecutor stopped with button push, after the callbacks
+// of the second core have stopped
+void sketchStop(void) {
+  Serial.print("Last average: ");
+  Serial.println(average);
+}
+
+// Averages 64 readings, which takes most of the 5 milliseconds
+void sampleCallback(void) {
+  long sum = 0;
+  for(int reading = 0; reading < 64; reading++) {
+    sum += analogRead(A0);
+  }
+  average = sum / 64;
+}
+
+void reportCallback(void) {
+  Serial.print("Average: ");
+  Serial.println(average);
+}
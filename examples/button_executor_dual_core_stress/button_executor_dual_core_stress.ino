@@ -0,0 +1,210 @@
+/**
+ * Code written by Mark Womack
+ * Distributed under the Apache License 2.0, a copy of which should accompany
+ * this file.
+ *
+ * Example code that stress tests the stop handshake between the two cores of
+ * an RP2040 or ESP32. A virtual button, read with setPinReader, starts and
+ * stops execution over and over with random run lengths, while callbacks of
+ * random length run on the second core. Every eighth run the second core
+ * stops calling the loop1 method just before the stop, as if it were stuck,
+ * and only resumes a while after execution has stopped, so the callbacks it
+ * did not stop are reported when the wait times out. After every run the
+ * invariants are checked: the sketchStopCallback method never overlaps a
+ * callback of the second core unless it was stuck, execution stops within
+ * the graceful stop timeout even when it is stuck, no callback of the second
+ * core is called after the stop, and the integrity check passes. Every run
+ * prints its result, the runs continue forever. No circuit is needed.
+ *
+ * The library must be built with this flag, for example in the build_flags
+ * of a PlatformIO project:
+ *   -DBUTTON_EXECUTOR_CORE_CALLBACKS=4
+ */
+
+#include <ButtonExecutor.h>
+
+#if BUTTON_EXECUTOR_CORE_CALLBACKS < 2
+#error "This example requires BUTTON_EXECUTOR_CORE_CALLBACKS of 2 or more"
+#endif
+#if !defined(ARDUINO_ARCH_RP2040) && !defined(ESP32)
+#error "This example requires an RP2040 or ESP32"
+#endif
+
+#define BUTTON_PIN (12)
+#define PRESS_MS (30)
+#define GRACEFUL_STOP_MS (100)
+// Two button checks, plus some slack for the serial output
+#define MAX_STOP_LATENCY_MS (GRACEFUL_STOP_MS + 40)
+#define STUCK_AFTER_STOP_MS (300)
+
+ButtonExecutor buttonExecutor(&Serial);
+
+// Virtual button, pushed by the loop method
+volatile int buttonLevel = LOW;
+unsigned long pressTime;
+unsigned long nextPressInterval;
+
+// Shared between the cores, so volatile. Only the second core writes the
+// state of its callbacks, only the main core writes isSecondCoreStuck.
+volatile boolean isCoreCallbackRunning;
+volatile unsigned long coreCalls;
+volatile boolean isSecondCoreStuck;
+unsigned long coreSeed = 1;
+
+// Bookkeeping of the sketch to check the ButtonExecutor against
+boolean isExecuting;
+boolean isRunDone;
+boolean isStuckRun;
+unsigned long stopPressTime;
+boolean isStopOverdue;
+unsigned long stopTime;
+unsigned long coreCallsAtStop;
+unsigned long runs;
+unsigned long violations;
+
+void setup() {
+  Serial.begin(9600);
+  randomSeed(42);
+
+  buttonExecutor.setPinReader(readVirtualButton);
+  buttonExecutor.setGracefulStopTimeout(GRACEFUL_STOP_MS);
+  buttonExecutor.setup(BUTTON_PIN, HIGH, sketchSetup, sketchStart, sketchStop);
+
+#if defined(ESP32)
+  // The Arduino loop runs on core 1, so the second core is core 0
+  xTaskCreatePinnedToCore(secondCoreTask, "loop1", 4096, NULL, 1, NULL, 0);
+#endif
+}
+
+void loop() {
+  buttonExecutor.loop();
+  unsigned long now = millis();
+
+  if (buttonLevel == HIGH && now - pressTime >= PRESS_MS) {
+    buttonLevel = LOW;
+  }
+
+  // The second core comes back a while after the stop
+  if (isSecondCoreStuck && !isExecuting
+      && now - stopTime >= STUCK_AFTER_STOP_MS) {
+    isSecondCoreStuck = false;
+  }
+
+  // A stop that never completes is reported once
+  if (isExecuting && stopPressTime != 0 && !isStopOverdue
+      && now - stopPressTime > MAX_STOP_LATENCY_MS) {
+    isStopOverdue = true;
+    violation("stop took longer than the graceful stop timeout");
+  }
+
+  if (isRunDone) {
+    isRunDone = false;
+    checkRun();
+  }
+
+  // Push the button to start when stopped, or to stop when executing
+  if (buttonLevel == LOW && now - pressTime >= nextPressInterval) {
+    if (!isExecuting && !isSecondCoreStuck) {
+      pushButton(now);
+      nextPressInterval = random(PRESS_MS * 2, 300);
+    } else if (isExecuting && stopPressTime == 0) {
+      isStuckRun = (runs % 8) == 7;
+      isSecondCoreStuck = isStuckRun;
+      stopPressTime = now;
+      pushButton(now);
+      nextPressInterval = random(PRESS_MS * 2, 300);
+    }
+  }
+}
+
+#if defined(ARDUINO_ARCH_RP2040)
+// Called repeatedly on the second core of the RP2040
+void loop1() {
+  if (!isSecondCoreStuck) {
+    buttonExecutor.loop1();
+  }
+}
+#else
+void secondCoreTask(void* parameters) {
+  while (true) {
+    if (!isSecondCoreStuck) {
+      buttonExecutor.loop1();
+    }
+    // Let the idle task of the core feed its watchdog
+    vTaskDelay(1);
+  }
+}
+#endif
+
+int readVirtualButton(uint8_t pin) {
+  return pin == BUTTON_PIN ? buttonLevel : LOW;
+}
+
+void pushButton(unsigned long now) {
+  pressTime = now;
+  buttonLevel = HIGH;
+}
+
+// Called when the buttonExecutor is set up
+void sketchSetup(void) {
+  isExecuting = false;
+}
+
+// Called when the buttonExecutor is started with button push
+void sketchStart(void) {
+  // Nothing of the second core may have run since the last stop
+  if (runs > 0 && coreCalls != coreCallsAtStop) {
+    violation("second core called after the stop");
+  }
+
+  isExecuting = true;
+  stopPressTime = 0;
+  isStopOverdue = false;
+  if (buttonExecutor.callbackEveryByMillisOnCore(1, &coreCallback,
+      SECOND_CORE) == CALLBACK_NOT_INSTALLED
+      || buttonExecutor.callbackEveryByMillisOnCore(3, &coreCallback,
+      SECOND_CORE) == CALLBACK_NOT_INSTALLED) {
+    violation("second core callback not installed");
+  }
+}
+
+// Called when buttonExecutor stopped with button push
+void sketchStop(void) {
+  // Only a stuck second core may still be running a callback
+  if (isCoreCallbackRunning && !isStuckRun) {
+    violation("stop overlapped a second core callback");
+  }
+
+  stopTime = millis();
+  coreCallsAtStop = coreCalls;
+  isExecuting = false;
+  isRunDone = true;
+}
+
+// Called on the second core, busy for a random time of up to 1.5 milliseconds
+void coreCallback(void) {
+  isCoreCallbackRunning = true;
+  coreCalls++;
+  coreSeed = coreSeed * 1103515245UL + 12345UL;
+  delayMicroseconds(100 + (coreSeed >> 16) % 1400);
+  isCoreCallbackRunning = false;
+}
+
+void checkRun(void) {
+  if (!buttonExecutor.checkIntegrity()) {
+    violation("integrity check failed");
+  }
+
+  runs++;
+  Serial.print("Run ");
+  Serial.print(runs);
+  Serial.print(isStuckRun ? " (stuck)" : "");
+  Serial.print(violations ? " FAIL, violations: " : " PASS, violations: ");
+  Serial.println(violations);
+}
+
+void violation(const char* message) {
+  violations++;
+  Serial.print("Violation: ");
+  Serial.println(message);
+}
@@ -0,0 +1,200 @@
+/**
+ * Code written by Mark Womack
+ * Distributed under the Apache License 2.0, a copy of which should accompany
+ * this file.
+ *
+ * Example code that stress tests the FreeRTOS scheduler on a board that runs
+ * FreeRTOS, such as the ESP32. A virtual button, read with setPinReader,
+ * starts and stops execution over and over with random run lengths. While
+ * executing, callbacks with short random periods are registered until the
+ * scheduler is full, and random callbacks are stopped and registered again,
+ * both from the loop method and from inside the callbacks while they are
+ * dispatched. Callbacks are also restarted with a new period right after
+ * they are stopped, while their timer may still be busy in the timer
+ * service. Registrations that fail because the scheduler is full are counted
+ * but allowed.
+ *
+ * After every step the invariants are checked: no callback is called after
+ * it was stopped or after execution was stopped, no more callbacks are
+ * registered than the sketch knows of, none are left after the stop, and
+ * the integrity check passes. Every run prints its result, the runs continue
+ * forever. No circuit is needed.
+ *
+ * The library must be built with these flags, for example in the
+ * build_flags of a PlatformIO project, so that the callbacks of the sketch
+ * do not all fit in the scheduler:
+ *   -DBUTTON_EXECUTOR_SCHEDULER=BUTTON_EXECUTOR_FREERTOS_SCHEDULER
+ *   -DFREERTOS_SCHEDULER_MAX_EVENTS=8
+ */
+
+#include <ButtonExecutor.h>
+
+#define BUTTON_PIN (12)
+#define PRESS_MS (30)
+#define NUMBER_OF_STRESS_CALLBACKS (8)
+
+#if BUTTON_EXECUTOR_SCHEDULER != BUTTON_EXECUTOR_FREERTOS_SCHEDULER
+#error "This example requires the FreeRTOS scheduler"
+#endif
+#if SCHEDULER_MAX_EVENTS > NUMBER_OF_STRESS_CALLBACKS
+#error "This example requires FREERTOS_SCHEDULER_MAX_EVENTS of 8 or less"
+#endif
+
+ButtonExecutor buttonExecutor(&Serial);
+
+// Virtual button, pushed by the loop method
+volatile int buttonLevel = LOW;
+unsigned long pressTime;
+unsigned long nextPressInterval;
+
+// Bookkeeping of the sketch to check the ButtonExecutor against
+boolean isExecuting;
+boolean isRunDone;
+int8_t callbackIds[NUMBER_OF_STRESS_CALLBACKS];
+unsigned long runs;
+unsigned long notInstalled;
+unsigned long violations;
+
+void stressCallback0(void);
+void stressCallback1(void);
+void stressCallback2(void);
+void stressCallback3(void);
+void stressCallback4(void);
+void stressCallback5(void);
+void stressCallback6(void);
+void stressCallback7(void);
+
+void (*stressCallbacks[NUMBER_OF_STRESS_CALLBACKS])(void) = {
+  stressCallback0, stressCallback1, stressCallback2, stressCallback3,
+  stressCallback4, stressCallback5, stressCallback6, stressCallback7
+};
+
+void setup() {
+  Serial.begin(9600);
+  randomSeed(42);
+
+  buttonExecutor.setPinReader(readVirtualButton);
+  buttonExecutor.setup(BUTTON_PIN, HIGH, sketchSetup, sketchStart, sketchStop);
+}
+
+void loop() {
+  buttonExecutor.loop();
+  unsigned long now = millis();
+
+  if (buttonLevel == HIGH && now - pressTime >= PRESS_MS) {
+    buttonLevel = LOW;
+  }
+  if (buttonLevel == LOW && now - pressTime >= nextPressInterval) {
+    pressTime = now;
+    buttonLevel = HIGH;
+    nextPressInterval = random(PRESS_MS * 2, 500);
+  }
+
+  if (isExecuting) {
+    stressStep();
+  }
+  checkInvariants();
+
+  if (isRunDone) {
+    isRunDone = false;
+    runs++;
+    Serial.print("Run ");
+    Serial.print(runs);
+    Serial.print(violations ? " FAIL, violations: " : " PASS, violations: ");
+    Serial.print(violations);
+    Serial.print(", not installed: ");
+    Serial.println(notInstalled);
+  }
+}
+
+int readVirtualButton(uint8_t pin) {
+  return pin == BUTTON_PIN ? buttonLevel : LOW;
+}
+
+// Called when the buttonExecutor is set up
+void sketchSetup(void) {
+  isExecuting = false;
+  forgetCallbacks();
+}
+
+// Called when the buttonExecutor is started with button push
+void sketchStart(void) {
+  isExecuting = true;
+
+  // Fill the scheduler
+  for(int index = 0; index < NUMBER_OF_STRESS_CALLBACKS; index++) {
+    registerCallback(index);
+  }
+}
+
+// Called when buttonExecutor stopped with button push
+void sketchStop(void) {
+  isExecuting = false;
+  isRunDone = true;
+  forgetCallbacks();
+}
+
+void forgetCallbacks(void) {
+  for(int index = 0; index < NUMBER_OF_STRESS_CALLBACKS; index++) {
+    callbackIds[index] = CALLBACK_NOT_INSTALLED;
+  }
+}
+
+void registerCallback(int index) {
+  callbackIds[index] = buttonExecutor.callbackEveryByMillis(random(1, 20),
+    stressCallbacks[index]);
+  if (callbackIds[index] == CALLBACK_NOT_INSTALLED) {
+    notInstalled++;
+  }
+}
+
+// Stops, restarts or registers a random callback
+void stressStep(void) {
+  int index = random(NUMBER_OF_STRESS_CALLBACKS);
+  if (callbackIds[index] != CALLBACK_NOT_INSTALLED) {
+    buttonExecutor.stopCallback(callbackIds[index]);
+    callbackIds[index] = CALLBACK_NOT_INSTALLED;
+    if (random(2) == 0) {
+      registerCallback(index);
+    }
+  } else {
+    registerCallback(index);
+  }
+}
+
+// Checks that the callback was called while executing and not stopped
+void stressCallback(int index) {
+  if (!isExecuting || callbackIds[index] == CALLBACK_NOT_INSTALLED) {
+    violations++;
+  }
+
+  // Sometimes make a change from inside the callback
+  if (random(4) == 0) {
+    stressStep();
+  }
+}
+
+void stressCallback0(void) { stressCallback(0); }
+void stressCallback1(void) { stressCallback(1); }
+void stressCallback2(void) { stressCallback(2); }
+void stressCallback3(void) { stressCallback(3); }
+void stressCallback4(void) { stressCallback(4); }
+void stressCallback5(void) { stressCallback(5); }
+void stressCallback6(void) { stressCallback(6); }
+void stressCallback7(void) { stressCallback(7); }
+
+// Checks that no callbacks leaked and the bookkeeping is consistent. A
+// callback registered while dispatching can still be dropped when the
+// scheduler is full, so the ButtonExecutor may have fewer callbacks.
+void checkInvariants(void) {
+  uint8_t numberOfCallbacks = 0;
+  for(int index = 0; index < NUMBER_OF_STRESS_CALLBACKS; index++) {
+    if (callbackIds[index] != CALLBACK_NOT_INSTALLED) {
+      numberOfCallbacks++;
+    }
+  }
+  if (!buttonExecutor.checkIntegrity()
+      || buttonExecutor.getNumberOfCallbacks() > numberOfCallbacks) {
+    violations++;
+  }
+}
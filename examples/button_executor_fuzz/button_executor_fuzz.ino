@@ -0,0 +1,169 @@
+/**
+ * Code written by Mark Womack
+ * Distributed under the Apache License 2.0, a copy of which should accompany
+ * this file.
+ * 
+ * Example code that fuzzes the callback registration of the ButtonExecutor on
+ * a simulated clock with the ButtonExecutorSimulator. Random sequences of
+ * callbackEveryByMillis, stopCallback and abortExecution calls are made, both
+ * from the sketch and from inside the callbacks while they are dispatched,
+ * mixed with random bouncing button pushes. After every step the invariants
+ * are checked: no slot leaks, no callback called twice at the same time and
+ * no callback called after execution was stopped. Every round prints its
+ * result, the rounds continue forever with new random sequences. No circuit
+ * is needed.
+ *
+ * The library must be built with these flags, for example in the
+ * build_flags of a PlatformIO project (or with
+ * BUTTON_EXECUTOR_TIMING_WHEEL_SCHEDULER):
+ *   -DBUTTON_EXECUTOR_SCHEDULER=BUTTON_EXECUTOR_LINEAR_SCHEDULER
+ */
+
+#include <ButtonExecutor.h>
+#include <ButtonExecutorSimulator.h>
+
+#ifndef SCHEDULER_HAS_CLOCK
+#error "This example requires the linear or timing wheel scheduler"
+#endif
+
+#define BUTTON_PIN (12)
+#define NUMBER_OF_EDGES (40)
+#define NUMBER_OF_FUZZ_CALLBACKS (4)
+#define STEPS_PER_ROUND (500)
+
+ButtonExecutor buttonExecutor(&Serial);
+ButtonExecutorSimulator simulator;
+
+ButtonScriptEdge script[NUMBER_OF_EDGES];
+uint8_t buttonLevel = LOW;
+
+// Bookkeeping of the sketch to check the ButtonExecutor against
+boolean isExecuting;
+int8_t callbackIds[NUMBER_OF_FUZZ_CALLBACKS];
+unsigned long lastCallTimes[NUMBER_OF_FUZZ_CALLBACKS];
+unsigned long rounds;
+unsigned long violations;
+
+void fuzzCallback0(void);
+void fuzzCallback1(void);
+void fuzzCallback2(void);
+void fuzzCallback3(void);
+
+void (*fuzzCallbacks[NUMBER_OF_FUZZ_CALLBACKS])(void) = {
+  fuzzCallback0, fuzzCallback1, fuzzCallback2, fuzzCallback3
+};
+
+void setup() {
+  Serial.begin(9600);
+  randomSeed(42);
+
+  simulator.begin(&buttonExecutor, BUTTON_PIN, buttonLevel);
+  buttonExecutor.setup(BUTTON_PIN, HIGH, sketchSetup, sketchStart, sketchStop);
+}
+
+void loop() {
+  // New random button pushes for this round, starting from now
+  unsigned long time = ButtonExecutorSimulator::millis();
+  for(int index = 0; index < NUMBER_OF_EDGES; index++) {
+    time += random(5, 400);
+    buttonLevel = !buttonLevel;
+    script[index].timeInMs = time;
+    script[index].level = buttonLevel;
+  }
+  simulator.setScript(script, NUMBER_OF_EDGES, random(0, 5), 4000);
+
+  for(int step = 0; step < STEPS_PER_ROUND; step++) {
+    fuzzStep();
+    simulator.runUntil(ButtonExecutorSimulator::millis() + random(1, 50),
+      random(50, 2000));
+    checkInvariants();
+  }
+
+  rounds++;
+  Serial.print("Round ");
+  Serial.print(rounds);
+  Serial.print(violations ? " FAIL, violations: " : " PASS, violations: ");
+  Serial.println(violations);
+}
+
+// Called when the buttonExecutor is set up
+void sketchSetup(void) {
+  isExecuting = false;
+  forgetCallbacks();
+}
+
+// Called when the buttonExecutor is started with button push
+void sketchStart(void) {
+  isExecuting = true;
+  fuzzStep();
+}
+
+// Called when buttonExecutor stopped with button push
+void sketchStop(void) {
+  isExecuting = false;
+  forgetCallbacks();
+}
+
+void forgetCallbacks(void) {
+  for(int index = 0; index < NUMBER_OF_FUZZ_CALLBACKS; index++) {
+    callbackIds[index] = CALLBACK_NOT_INSTALLED;
+  }
+}
+
+// Makes one random call, callbacks are only registered while executing
+void fuzzStep(void) {
+  int index = random(NUMBER_OF_FUZZ_CALLBACKS);
+  switch (random(10)) {
+    case 0:
+      buttonExecutor.abortExecution();
+      break;
+    case 1:
+    case 2:
+    case 3:
+      if (callbackIds[index] != CALLBACK_NOT_INSTALLED) {
+        buttonExecutor.stopCallback(callbackIds[index]);
+        callbackIds[index] = CALLBACK_NOT_INSTALLED;
+      }
+      break;
+    default:
+      if (isExecuting && callbackIds[index] == CALLBACK_NOT_INSTALLED) {
+        callbackIds[index] = buttonExecutor.callbackEveryByMillis(
+          random(1, 100), fuzzCallbacks[index]);
+      }
+      break;
+  }
+}
+
+// Checks that the callback was called while executing and only once a tick
+void fuzzCallback(int index) {
+  unsigned long now = ButtonExecutorSimulator::millis();
+  if (!isExecuting || callbackIds[index] == CALLBACK_NOT_INSTALLED
+      || now == lastCallTimes[index]) {
+    violations++;
+  }
+  lastCallTimes[index] = now;
+
+  // Sometimes make a call from inside the callback
+  if (random(4) == 0) {
+    fuzzStep();
+  }
+}
+
+void fuzzCallback0(void) { fuzzCallback(0); }
+void fuzzCallback1(void) { fuzzCallback(1); }
+void fuzzCallback2(void) { fuzzCallback(2); }
+void fuzzCallback3(void) { fuzzCallback(3); }
+
+// Checks that no callbacks leaked and the bookkeeping is consistent
+void checkInvariants(void) {
+  uint8_t numberOfCallbacks = 0;
+  for(int index = 0; index < NUMBER_OF_FUZZ_CALLBACKS; index++) {
+    if (callbackIds[index] != CALLBACK_NOT_INSTALLED) {
+      numberOfCallbacks++;
+    }
+  }
+  if (!buttonExecutor.checkIntegrity()
+      || buttonExecutor.getNumberOfCallbacks() != numberOfCallbacks) {
+    violations++;
+  }
+}
@@ -0,0 +1,78 @@
+/**
+ * Code written by Mark Womack
+ * Distributed under the Apache License 2.0, a copy of which should accompany
+ * this file.
+ * 
+ * Example code that demonstrates callbacks on the edges of input pins. The
+ * LED on pin 13 blinks while a motor runs, and execution stops as soon as a
+ * limit switch on pin 2 closes. Pulses of a sensor on pin 3 are counted. You
+ * will need the basic circuit with a momentary push button connected to
+ * pin 12, a switch from pin 2 to ground and a sensor on pin 3.
+ *
+ * The library must be built with this flag, for example in the build_flags
+ * of a PlatformIO project:
+ *   -DBUTTON_EXECUTOR_WATCHES=2
+ */
+ 
+#include <ButtonExecutor.h>
+
+#if BUTTON_EXECUTOR_WATCHES < 2
+#error "This example requires BUTTON_EXECUTOR_WATCHES of 2 or more"
+#endif
+
+ButtonExecutor buttonExecutor(&Serial);
+
+#define LIMIT_SWITCH_PIN (2)
+#define SENSOR_PIN (3)
+
+boolean ledState;
+unsigned long pulses;
+
+void setup() {
+  Serial.begin(9600);
+
+  pinMode(LIMIT_SWITCH_PIN, INPUT_PULLUP);
+  pinMode(SENSOR_PIN, INPUT);
+  pinMode(13, OUTPUT);
+
+  // Monitor pin 12 for button pushes which will be HIGH
+  buttonExecutor.setup(12, HIGH, sketchSetup, sketchStart, sketchStop);
+}
+
+void loop() {
+  buttonExecutor.loop();
+}
+
+// Called when the buttonExecutor is set up
+void sketchSetup(void) {
+  // Watched on every execution, the switch closes to ground
+  buttonExecutor.callbackOnPinEdge(LIMIT_SWITCH_PIN, FALLING, &limitCallback);
+  buttonExecutor.callbackOnPinEdge(SENSOR_PIN, RISING, &pulseCallback);
+}
+
+// Called when the buttonExecutor is started with button push
+void sketchStart(void) {
+  pulses = 0;
+  buttonExecutor.callbackEveryByMillis(250, &blinkCallback);
+}
+
+// Called when buttonExecutor stopped with button push
+void sketchStop(void) {
+  digitalWrite(13, LOW);
+  Serial.print("Pulses: ");
+  Serial.println(pulses);
+}
+
+void blinkCallback(void) {
+  ledState = !ledState;
+  digitalWrite(13, ledState ? HIGH : LOW);
+}
+
+void limitCallback(void) {
+  Serial.println("Limit reached");
+  buttonExecutor.abortExecution();
+}
+
+void pulseCallback(void) {
+  pulses++;
+}
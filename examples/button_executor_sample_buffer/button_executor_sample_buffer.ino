@@ -0,0 +1,79 @@
+/**
+ * Code written by Mark Womack
+ * Distributed under the Apache License 2.0, a copy of which should accompany
+ * this file.
+ * 
+ * Example code that demonstrates passing samples from a fast producer
+ * callback to a slow consumer callback with a SampleBuffer. An analog input
+ * is read 1000 times a second and the samples are averaged in batches 10
+ * times a second. You will need the basic circuit with a momentary push
+ * button connected to pin 12, and anything connected to A0.
+ *
+ * The library must be built with this flag, for example in the build_flags
+ * of a PlatformIO project:
+ *   -DBUTTON_EXECUTOR_SAMPLE_BUFFERS=1
+ */
+ 
+#include <ButtonExecutor.h>
+#include <SampleBuffer.h>
+
+#if BUTTON_EXECUTOR_SAMPLE_BUFFERS < 1
+#error "This example requires BUTTON_EXECUTOR_SAMPLE_BUFFERS of 1 or more"
+#endif
+
+ButtonExecutor buttonExecutor(&Serial);
+
+// Room for a little more than one batch, must be a power of two
+SampleBuffer<int, 128> samples;
+
+void setup() {
+  Serial.begin(9600);
+
+  // Monitor pin 12 for button pushes which will be HIGH
+  buttonExecutor.setup(12, HIGH, sketchSetup, sketchStart, sketchStop);
+}
+
+void loop() {
+  buttonExecutor.loop();
+}
+
+// Called when the buttonExecutor is set up
+void sketchSetup(void) {
+  // Cleared on every start, and the last samples averaged on every stop
+  buttonExecutor.registerSampleBuffer(&samples, &consumeCallback);
+}
+
+// Called when the buttonExecutor is started with button push
+void sketchStart(void) {
+  buttonExecutor.callbackEveryByMillis(1, &produceCallback);
+  buttonExecutor.callbackEveryByMillis(100, &consumeCallback);
+}
+
+// Called when buttonExecutor stopped with button push
+void sketchStop(void) {
+  Serial.print("Dropped samples: ");
+  Serial.println(samples.getDropped());
+}
+
+void produceCallback(void) {
+  samples.push(analogRead(A0));
+}
+
+// Averages the samples in place, without copying them out of the buffer
+void consumeCallback(void) {
+  uint16_t count = samples.available();
+  if (count == 0) {
+    return;
+  }
+
+  long sum = 0;
+  for(uint16_t index = 0; index < count; index++) {
+    sum += samples.peek(index);
+  }
+  samples.release(count);
+
+  Serial.print("Samples: ");
+  Serial.print(count);
+  Serial.print(", average: ");
+  Serial.println(sum / count);
+}
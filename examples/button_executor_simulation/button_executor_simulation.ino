@@ -0,0 +1,120 @@
+/**
+ * Code written by Mark Womack
+ * Distributed under the Apache License 2.0, a copy of which should accompany
+ * this file.
+ * 
+ * Example code that demonstrates running the ButtonExecutor on a simulated
+ * clock with the ButtonExecutorSimulator. A script of bouncing button pushes
+ * is replayed and the recorded trace is checked: execution must start and
+ * stop exactly once, and the callback must be called on time while executing
+ * and never after. No circuit is needed.
+ *
+ * The library must be built with these flags, for example in the
+ * build_flags of a PlatformIO project (or with
+ * BUTTON_EXECUTOR_TIMING_WHEEL_SCHEDULER):
+ *   -DBUTTON_EXECUTOR_SCHEDULER=BUTTON_EXECUTOR_LINEAR_SCHEDULER
+ *   -DBUTTON_EXECUTOR_TRACE_SIZE=64
+ */
+
+#include <ButtonExecutor.h>
+#include <ButtonExecutorSimulator.h>
+
+#ifndef SCHEDULER_HAS_CLOCK
+#error "This example requires the linear or timing wheel scheduler"
+#endif
+#if BUTTON_EXECUTOR_TRACE_SIZE < 64
+#error "This example requires a BUTTON_EXECUTOR_TRACE_SIZE of at least 64"
+#endif
+
+#define BUTTON_PIN (12)
+#define PERIOD_MS (50)
+
+ButtonExecutor buttonExecutor(&Serial);
+ButtonExecutorSimulator simulator;
+
+// Pushed twice, every edge bounces 4 times over 8 ms
+const ButtonScriptEdge script[] = {
+  { 103, HIGH }, { 305, LOW }, { 1107, HIGH }, { 1302, LOW }
+};
+
+TraceEvent trace[BUTTON_EXECUTOR_TRACE_SIZE];
+int count;
+
+void setup() {
+  Serial.begin(9600);
+
+  simulator.begin(&buttonExecutor, BUTTON_PIN, LOW);
+  simulator.setScript(script, sizeof(script) / sizeof(script[0]), 4, 8000);
+  buttonExecutor.setup(BUTTON_PIN, HIGH, sketchSetup, sketchStart, sketchStop);
+
+  // Each call to loop takes 100 microseconds of simulated time
+  simulator.runUntil(2000, 100);
+  buttonExecutor.dumpTrace();
+  checkTrace();
+
+  // Measure how fast simulated time runs on this board
+  unsigned long startTime = millis();
+  simulator.runUntil(2000 + 600000UL, 1000);
+  Serial.print("Simulated 10 minutes in ms: ");
+  Serial.println(millis() - startTime);
+}
+
+void loop() {
+}
+
+// Called when the buttonExecutor is set up
+void sketchSetup(void) {
+  count = 0;
+}
+
+// Called when the buttonExecutor is started with button push
+void sketchStart(void) {
+  buttonExecutor.callbackEveryByMillis(PERIOD_MS, &sampleCallback);
+}
+
+// Called when buttonExecutor stopped with button push
+void sketchStop(void) {
+}
+
+void sampleCallback(void) {
+  count++;
+}
+
+// Checks the recorded trace and prints the result
+void checkTrace(void) {
+  uint16_t numberOfEvents = buttonExecutor.getTrace(trace,
+    BUTTON_EXECUTOR_TRACE_SIZE);
+  int starts = 0;
+  int stops = 0;
+  int dispatches = 0;
+  boolean isOk = true;
+  unsigned long lastDispatchTime = 0;
+
+  for(uint16_t index = 0; index < numberOfEvents; index++) {
+    TraceEvent& event = trace[index];
+    if (event.type == TRACE_START) {
+      starts++;
+      lastDispatchTime = event.timestamp;
+    } else if (event.type == TRACE_STOP) {
+      stops++;
+    } else if (event.type == TRACE_DISPATCH) {
+      dispatches++;
+
+      // Never called when not executing, never later than 1 ms
+      if (starts != stops + 1
+          || event.timestamp - lastDispatchTime > PERIOD_MS * 1000UL + 1000) {
+        isOk = false;
+      }
+      lastDispatchTime = event.timestamp;
+    }
+  }
+
+  isOk = isOk && starts == 1 && stops == 1 && dispatches == count;
+  Serial.print("Starts: ");
+  Serial.print(starts);
+  Serial.print(", stops: ");
+  Serial.print(stops);
+  Serial.print(", callbacks: ");
+  Serial.println(dispatches);
+  Serial.println(isOk ? "PASS" : "FAIL");
+}
@@ -0,0 +1,89 @@
+/**
+ * Code written by Mark Womack
+ * Distributed under the Apache License 2.0, a copy of which should accompany
+ * this file.
+ * 
+ * Example code that demonstrates a high-rate callback called from a hardware
+ * timer. A stepper driver, such as an A4988, is stepped 2000 times a second
+ * from the Timer1 interrupt, while a slower callback reports the number of
+ * steps once a second. You will need the basic circuit with a momentary push
+ * button connected to pin 12, and the STEP and DIR inputs of the driver
+ * connected to pins 3 and 4. This example only runs on AVR boards, such as
+ * the Arduino Uno.
+ *
+ * The library must be built with this flag, for example in the build_flags
+ * of a PlatformIO project:
+ *   -DBUTTON_EXECUTOR_DISPATCH_TIMERS=1
+ */
+ 
+#include <ButtonExecutor.h>
+#include <AvrTimer1DispatchTimer.h>
+
+#if BUTTON_EXECUTOR_DISPATCH_TIMERS < 1
+#error "This example requires BUTTON_EXECUTOR_DISPATCH_TIMERS of 1 or more"
+#endif
+
+#define STEP_PIN (3)
+#define DIR_PIN (4)
+#define STEP_PERIOD_US (500)
+
+ButtonExecutor buttonExecutor(&Serial);
+AvrTimer1DispatchTimer stepTimer;
+
+// Shared with the interrupt, so volatile
+volatile unsigned long steps;
+
+void setup() {
+  Serial.begin(9600);
+
+  // Monitor pin 12 for button pushes which will be HIGH
+  buttonExecutor.setup(12, HIGH, sketchSetup, sketchStart, sketchStop);
+}
+
+void loop() {
+  buttonExecutor.loop();
+}
+
+// Called when the buttonExecutor is set up
+void sketchSetup(void) {
+  pinMode(STEP_PIN, OUTPUT);
+  pinMode(DIR_PIN, OUTPUT);
+}
+
+// Called when the buttonExecutor is started with button push
+void sketchStart(void) {
+  steps = 0;
+  digitalWrite(DIR_PIN, HIGH);
+
+  // Called from the Timer1 interrupt every 500 microseconds
+  if (buttonExecutor.callbackEveryByMicros(&stepTimer, STEP_PERIOD_US,
+      &stepCallback) == CALLBACK_NOT_INSTALLED) {
+    Serial.println("Step timer not installed!");
+  }
+
+  // Called every second from the loop
+  buttonExecutor.callbackEveryByMillis(1000, &reportCallback);
+}
+
+// Called when buttonExecutor stopped with button push, the step timer is
+// already stopped
+void sketchStop(void) {
+  digitalWrite(STEP_PIN, LOW);
+}
+
+// Pulses the STEP pin, the driver steps on the rising edge
+void stepCallback(void) {
+  digitalWrite(STEP_PIN, HIGH);
+  steps++;
+  digitalWrite(STEP_PIN, LOW);
+}
+
+void reportCallback(void) {
+  // Read the steps with the interrupt off, they are more than one byte
+  noInterrupts();
+  unsigned long currentSteps = steps;
+  interrupts();
+
+  Serial.print("Steps: ");
+  Serial.println(currentSteps);
+}
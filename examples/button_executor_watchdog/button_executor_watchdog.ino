@@ -0,0 +1,135 @@
+/**
+ * Code written by Mark Womack
+ * Distributed under the Apache License 2.0, a copy of which should accompany
+ * this file.
+ * 
+ * Example code that demonstrates the watchdog post-mortem on a simulated
+ * clock with the ButtonExecutorSimulator. A simulated button push starts
+ * execution, then one of the callbacks gets stuck, so the ButtonExecutor
+ * stops feeding the watchdog and the watchdog resets the microcontroller.
+ * After the reset, the setup method must report the callback that was
+ * running. No circuit is needed.
+ *
+ * The watchdog is simulated with a SimulatedDispatchTimer, which checks that
+ * it was fed every WATCHDOG_MS like a hardware watchdog counts down in the
+ * background. The reset is simulated by jumping back to the start of the
+ * setup method with longjmp. A real reset would clear all variables except
+ * those in the .noinit section, which is where the ButtonExecutor keeps the
+ * id of the running callback, and calling ButtonExecutor.setup again starts
+ * it over the same way.
+ *
+ * The library must be built with these flags, for example in the
+ * build_flags of a PlatformIO project (or with
+ * BUTTON_EXECUTOR_TIMING_WHEEL_SCHEDULER):
+ *   -DBUTTON_EXECUTOR_SCHEDULER=BUTTON_EXECUTOR_LINEAR_SCHEDULER
+ */
+
+#include <setjmp.h>
+#include <ButtonExecutor.h>
+#include <ButtonExecutorSimulator.h>
+
+#ifndef SCHEDULER_HAS_CLOCK
+#error "This example requires the linear or timing wheel scheduler"
+#endif
+
+#define BUTTON_PIN (12)
+#define WATCHDOG_MS (16)
+#define MAX_PASS_MICROS (1000)
+
+ButtonExecutor buttonExecutor(&Serial);
+ButtonExecutorSimulator simulator;
+SimulatedDispatchTimer watchdogTimer;
+
+// Pushed once, the callbacks then run until one gets stuck
+const ButtonScriptEdge script[] = {
+  { 100, HIGH }, { 150, LOW }
+};
+
+// Where the simulated reset restarts the sketch
+jmp_buf resetPoint;
+volatile boolean isWatchdogFed;
+volatile int resets;
+volatile int8_t stuckCallbackId;
+int sensorCalls;
+
+void setup() {
+  Serial.begin(9600);
+
+  // The simulated watchdog jumps back here when it resets
+  if (setjmp(resetPoint)) {
+    resets++;
+    watchdogTimer.stop();
+  }
+
+  simulator.begin(&buttonExecutor, BUTTON_PIN, LOW);
+  buttonExecutor.setWatchdog(feedWatchdog, MAX_PASS_MICROS);
+  buttonExecutor.setup(BUTTON_PIN, HIGH, sketchSetup, sketchStart, sketchStop);
+
+  if (resets == 0) {
+    simulator.setScript(script, sizeof(script) / sizeof(script[0]), 0, 0);
+    isWatchdogFed = true;
+    watchdogTimer.start(WATCHDOG_MS * 1000UL, watchdogCheck);
+
+    // Each call to loop takes 100 microseconds of simulated time
+    simulator.runUntil(1000, 100);
+    Serial.println("The watchdog did not reset");
+    Serial.println("FAIL");
+    return;
+  }
+
+  // The setup method found the id of the stuck callback after the reset, and
+  // nothing is left running from before it
+  Serial.print("Reset while running callback: ");
+  Serial.print(buttonExecutor.getResetCallbackId());
+  Serial.print(", stuck callback: ");
+  Serial.println(stuckCallbackId);
+  Serial.println(resets == 1
+    && buttonExecutor.getResetCallbackId() == stuckCallbackId
+    && buttonExecutor.getNumberOfCallbacks() == 0
+    && buttonExecutor.checkIntegrity() ? "PASS" : "FAIL");
+}
+
+void loop() {
+}
+
+// Called when the buttonExecutor is set up
+void sketchSetup(void) {
+  sensorCalls = 0;
+}
+
+// Called when the buttonExecutor is started with button push
+void sketchStart(void) {
+  buttonExecutor.callbackEveryByMillis(10, &sensorCallback);
+  stuckCallbackId = buttonExecutor.callbackEveryByMillis(50, &stuckCallback);
+}
+
+// Called when buttonExecutor stopped with button push
+void sketchStop(void) {
+}
+
+// Only called when a pass of the loop method was short enough
+void feedWatchdog(void) {
+  isWatchdogFed = true;
+}
+
+// Called like an interrupt every WATCHDOG_MS of simulated time
+void watchdogCheck(void) {
+  if (!isWatchdogFed) {
+    longjmp(resetPoint, 1);
+  }
+  isWatchdogFed = false;
+}
+
+void sensorCallback(void) {
+  sensorCalls++;
+}
+
+// Gets stuck once the sensor has been read 20 times
+void stuckCallback(void) {
+  if (sensorCalls < 20) {
+    return;
+  }
+  while (true) {
+    simulator.busyWait(1000);
+  }
+}